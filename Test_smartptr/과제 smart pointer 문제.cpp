@@ -8,74 +8,3859 @@
 //		id, name, level, grade 등 데이타 맴버를 추가하세요.
 
 #include <iostream>
+#include <cstdint>
+#include <climits>
+#include <cstddef>
+#include <memory>
 #include <vector>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <map>
+#include <tuple>
+#include <utility>
 #include <algorithm>
 #include <functional>
+#include <variant>
+#include <optional>
+#include <chrono>
+#include <string>
+#include <numeric>
+#include <execution>
+#include <charconv>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <bitset>
+#include <filesystem>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <share.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ITEM_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ITEM_TARGET_AVX2
+#else
+#define ITEM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 using namespace std;
 
+// 할당 계측 : ITEM_COUNT_ALLOCATIONS 를 정의하면 전역 operator new / delete 를 바꿔 스레드별로 할당, 해제 횟수와 요청 바이트를 셉니다.
+//	실행 파일 전체의 할당을 바꾸므로 기본은 꺼져 있고, 꺼져 있으면 작업별 할당 수는 0 으로 남습니다.
+//	스레드 지역 변수만 올리므로 잠금이나 원자적 연산은 없습니다. (정렬 지정 new 는 바꾸지 않으므로 세지 않습니다)
+struct AllocationCounter
+{
+	uint64_t allocations = 0;
+	uint64_t frees = 0;
+	uint64_t bytes = 0;			// 요청한 바이트 (해제할 때는 크기를 모르므로 세지 않습니다)
+};
+inline AllocationCounter& ThreadAllocations()
+{
+	thread_local AllocationCounter counter;
+	return counter;
+}
+#ifdef ITEM_COUNT_ALLOCATIONS
+// 일반, 배열, nothrow 형태를 모두 바꿔서 어느 new 로 받은 메모리든 어느 delete 로 놓아도 짝이 맞도록 합니다.
+inline void* CountedAllocate(size_t size) noexcept
+{
+	AllocationCounter& counter = ThreadAllocations();
+	++counter.allocations;
+	counter.bytes += size;
+	return malloc(size ? size : 1);
+}
+inline void* CountedAllocateOrThrow(size_t size)
+{
+	for (;;)
+	{
+		if (void* memory = CountedAllocate(size)) return memory;
+		new_handler handler = get_new_handler();
+		if (!handler) throw bad_alloc();
+		handler();
+	}
+}
+inline void* CountedAllocateOrNull(size_t size) noexcept
+{
+	try { return CountedAllocateOrThrow(size); }
+	catch (...) { return nullptr; }
+}
+inline void CountedFree(void* memory) noexcept
+{
+	if (!memory) return;
+	++ThreadAllocations().frees;
+	free(memory);
+}
+void* operator new(size_t size) { return CountedAllocateOrThrow(size); }
+void* operator new[](size_t size) { return CountedAllocateOrThrow(size); }
+void* operator new(size_t size, const nothrow_t&) noexcept { return CountedAllocateOrNull(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return CountedAllocateOrNull(size); }
+void operator delete(void* memory) noexcept { CountedFree(memory); }
+void operator delete[](void* memory) noexcept { CountedFree(memory); }
+void operator delete(void* memory, size_t) noexcept { CountedFree(memory); }
+void operator delete[](void* memory, size_t) noexcept { CountedFree(memory); }
+void operator delete(void* memory, const nothrow_t&) noexcept { CountedFree(memory); }
+void operator delete[](void* memory, const nothrow_t&) noexcept { CountedFree(memory); }
+#endif
+
+// 같은 이름 문자열을 한 번만 저장하고 정수 번호(심볼)로 바꿔주는 테이블
+//	이름 순서(사전순)의 순위도 같이 관리해서, 이름 정렬은 정수 순위 비교로 합니다.
+//	새 이름이 들어와도 기존 이름끼리의 순위 관계는 바뀌지 않습니다.
+// 여러 스레드가 아이템을 만들 수 있으므로 이름 등록, 찾기는 잠금으로 보호하고,
+// 정렬, 출력에서 자주 부르는 Name, Less 는 잠금 없이 읽습니다. (주소가 바뀌지 않는 구간 배열)
+//	순위는 (세대 << 32) | 순위 로 저장하고, Less 는 두 순위를 같은 세대에서 읽었을 때만 비교합니다.
+//	그래서 순위를 다시 매기는 도중에도 서로 다른 이름이 같은 순위로 보이지 않습니다.
+// 이미 등록된 이름은 스레드별 사본에서 찾으므로, 아이템을 만들 때마다 공유 잠금을 두고 다투지 않습니다.
+class NameTable
+{
+	static constexpr size_t kSegmentBits = 12, kSegmentSize = size_t(1) << kSegmentBits, kMaxSegments = 4096;
+	struct Entry
+	{
+		const string* name;
+		atomic<uint64_t> rank;		// (순위를 매긴 세대 << 32) | 순위
+	};
+	// 이 스레드가 찾았던 이름 -> 심볼. 테이블마다 번호를 붙여, 다른 테이블의 사본을 쓰지 않습니다.
+	struct LocalSymbols
+	{
+		uint64_t table = 0;
+		unordered_map<string, uint32_t> symbols;
+	};
+
+	mutable shared_mutex lock;
+	unordered_map<string, uint32_t> symbols;		// unordered_map 의 키는 재해싱해도 주소가 유지됨
+	vector<uint32_t> sorted;						// 이름 순으로 정렬된 심볼들
+	unique_ptr<atomic<Entry*>[]> segments = make_unique<atomic<Entry*>[]>(kMaxSegments);
+	vector<unique_ptr<Entry[]>> owned;
+	uint32_t generation = 0;						// 순위를 다시 매길 때마다 1씩 (쓰기 잠금 안에서만)
+	const uint64_t id = NextId();
+
+	static uint64_t NextId()
+	{
+		static atomic<uint64_t> next{ 1 };
+		return next.fetch_add(1, memory_order_relaxed);
+	}
+	static LocalSymbols& Local()
+	{
+		thread_local LocalSymbols local;
+		return local;
+	}
+	Entry& At(uint32_t symbol) const { return segments[symbol >> kSegmentBits].load(memory_order_acquire)[symbol & (kSegmentSize - 1)]; }
+
+	uint32_t InternShared(const string& name)
+	{
+		{
+			shared_lock<shared_mutex> reading(lock);
+			auto found = symbols.find(name);
+			if (found != end(symbols)) return found->second;
+		}
+		unique_lock<shared_mutex> writing(lock);
+		auto found = symbols.find(name);
+		if (found != end(symbols)) return found->second;
+		uint32_t symbol = static_cast<uint32_t>(symbols.size());
+		// 구간 배열이 가득 차면 등록하지 않고 예외를 던집니다. 할당도 모두 등록 전에 해서, 실패하면 테이블은 그대로입니다.
+		if ((symbol >> kSegmentBits) >= kMaxSegments) throw length_error("NameTable: too many names");
+		unique_ptr<Entry[]> segment;
+		if ((symbol & (kSegmentSize - 1)) == 0) segment = make_unique<Entry[]>(kSegmentSize);
+		owned.reserve(owned.size() + 1);
+		sorted.reserve(sorted.size() + 1);
+		auto result = symbols.emplace(name, symbol);
+		if (segment)
+		{
+			segments[symbol >> kSegmentBits].store(segment.get(), memory_order_release);
+			owned.push_back(move(segment));
+		}
+		// 서로 다른 이름은 몇 백 개 정도라서, 새 이름이 들어올 때만 모든 이름의 순위를 새 세대로 다시 매깁니다.
+		// 읽는 쪽은 두 순위의 세대가 다르면 다시 읽으므로, 옛 순위와 새 순위를 섞어 비교하지 않습니다.
+		auto at = lower_bound(begin(sorted), end(sorted), name, [&](uint32_t s, const string& n) { return *At(s).name < n; });
+		sorted.insert(at, symbol);
+		At(symbol).name = &result.first->first;
+		++generation;
+		for (size_t i = 0; i < sorted.size(); ++i) At(sorted[i]).rank.store((uint64_t(generation) << 32) | i, memory_order_release);
+		return symbol;
+	}
+
+public:
+	static constexpr uint32_t npos = UINT32_MAX;
+
+	// 이름 테이블이 가득 차면 length_error 를 던집니다. (kMaxSegments * kSegmentSize 개)
+	uint32_t Intern(const string& name)
+	{
+		LocalSymbols& local = Local();
+		if (local.table != id)
+		{
+			local.symbols.clear();
+			local.table = id;
+		}
+		auto cached = local.symbols.find(name);
+		if (cached != end(local.symbols)) return cached->second;
+		uint32_t symbol = InternShared(name);
+		local.symbols.emplace(name, symbol);
+		return symbol;
+	}
+	uint32_t Find(const string& name) const
+	{
+		shared_lock<shared_mutex> reading(lock);
+		auto found = symbols.find(name);
+		return found != end(symbols) ? found->second : npos;
+	}
+	const string& Name(uint32_t symbol) const { return *At(symbol).name; }
+	// 이름 순서 비교 : 새 이름을 등록하는 중이라 두 순위의 세대가 다르면, 다시 매기기가 끝날 때까지 다시 읽습니다.
+	bool Less(uint32_t a, uint32_t b) const
+	{
+		if (a == b) return false;
+		const atomic<uint64_t>& rankA = At(a).rank;
+		const atomic<uint64_t>& rankB = At(b).rank;
+		for (;;)
+		{
+			uint64_t first = rankA.load(memory_order_acquire), second = rankB.load(memory_order_acquire);
+			if ((first >> 32) == (second >> 32)) return static_cast<uint32_t>(first) < static_cast<uint32_t>(second);
+			this_thread::yield();
+		}
+	}
+	// 심볼 -> 순위 표를 한 세대에서 떠서 돌려줍니다. 순위를 정렬 키에 담아 여러 아이템을 한꺼번에 정렬할 때 씁니다.
+	vector<uint32_t> Ranks() const
+	{
+		shared_lock<shared_mutex> reading(lock);
+		vector<uint32_t> ranks(sorted.size());
+		for (size_t i = 0; i < sorted.size(); ++i) ranks[sorted[i]] = static_cast<uint32_t>(i);
+		return ranks;
+	}
+	size_t Size() const { shared_lock<shared_mutex> reading(lock); return symbols.size(); }
+	// 테이블이 쓰는 바이트 (해시 노드, 이름 문자열의 힙 버퍼, 순위 구간 배열). 노드 크기는 추정값입니다.
+	size_t MemoryBytes() const
+	{
+		shared_lock<shared_mutex> reading(lock);
+		size_t bytes = symbols.bucket_count() * sizeof(void*) + symbols.size() * (sizeof(void*) + sizeof(pair<const string, uint32_t>) + sizeof(size_t));
+		for (auto& entry : symbols)
+		{
+			const string& name = entry.first;
+			const char* data = name.data();
+			bool inline_ = data >= reinterpret_cast<const char*>(&name) && data < reinterpret_cast<const char*>(&name) + sizeof(name);
+			if (!inline_) bytes += name.capacity() + 1;		// 짧은 문자열 최적화에 들어가지 않은 이름만 힙을 씁니다.
+		}
+		bytes += sorted.capacity() * sizeof(uint32_t) + kMaxSegments * sizeof(atomic<Entry*>) + owned.size() * kSegmentSize * sizeof(Entry);
+		return bytes;
+	}
+};
+
+// 모든 아이템이 함께 쓰는 이름 테이블
+inline NameTable& ItemNames()
+{
+	static NameTable table;
+	return table;
+}
+
+// 아이템 이름 : 문자열 대신 이름 테이블의 32비트 심볼만 들고 있습니다.
+//	복사는 정수 복사, 같은지 비교는 정수 비교, 순서 비교는 이름 순위 비교입니다.
+//	문자열에서 만들면 이름을 등록하므로 명시적으로만 만듭니다. (테이블이 가득 차면 length_error)
+//	문자열과 같은지 비교할 때는 등록하지 않고 문자열끼리 비교합니다.
+class ItemName
+{
+	uint32_t symbol;
+
+public:
+	explicit ItemName(const string& name) : symbol(ItemNames().Intern(name)) {}
+	explicit ItemName(const char* name) : ItemName(string(name)) {}
+
+	uint32_t Symbol() const { return symbol; }
+	const string& str() const { return ItemNames().Name(symbol); }
+	operator const string& () const { return str(); }
+
+	friend bool operator==(ItemName a, ItemName b) { return a.symbol == b.symbol; }
+	friend bool operator!=(ItemName a, ItemName b) { return a.symbol != b.symbol; }
+	friend bool operator==(ItemName a, const string& b) { return a.str() == b; }
+	friend bool operator==(const string& a, ItemName b) { return a == b.str(); }
+	friend bool operator==(ItemName a, const char* b) { return a.str() == b; }
+	friend bool operator==(const char* a, ItemName b) { return a == b.str(); }
+	friend bool operator!=(ItemName a, const string& b) { return !(a == b); }
+	friend bool operator!=(const string& a, ItemName b) { return !(a == b); }
+	friend bool operator!=(ItemName a, const char* b) { return !(a == b); }
+	friend bool operator!=(const char* a, ItemName b) { return !(a == b); }
+	friend bool operator<(ItemName a, ItemName b) { return ItemNames().Less(a.symbol, b.symbol); }
+	friend ostream& operator<<(ostream& os, ItemName name) { return os << name.str(); }
+};
+
+// 아이템 종류 : ItemValue 의 variant 순서와 같습니다. 스냅샷, 저널에도 이 값이 그대로 저장됩니다.
+enum class ItemCategory : uint8_t { Item, Weapon, Armor, Ring };
+constexpr size_t kItemCategoryCount = 4;
+
 class Item : enable_shared_from_this<Item> {
 public:
+	static constexpr ItemCategory kCategory = ItemCategory::Item;
 	int		id = 0;
-	string	name = "";
+	ItemName name;
 	int		level = 0;
 	char	grade = 'A';
-	Item(int id, string name, int level, char grade) : id(id), name(name), level(level), grade(grade) {    }
+	ItemCategory category = kCategory;	// 종류 태그 : dynamic_cast 없이 종류를 알 수 있도록, 빈 패딩 자리에 들어갑니다.
+	Item(int id, ItemName name, int level, char grade) : id(id), name(name), level(level), grade(grade) {    }
+	Item(int id, const string& name, int level, char grade) : Item(id, ItemName(name), level, grade) {    }	// 이름을 등록합니다.
+	// 복사, 이동은 종류 태그를 따라가지 않습니다. Weapon 을 Item 으로 잘라 복사하면 Item 태그가 붙습니다.
+	Item(const Item& other) : Item(other, kCategory) {    }
+	Item(Item&& other) noexcept : Item(other, kCategory) {    }		// 이름은 심볼이라 이동도 복사와 같습니다.
+	Item& operator=(const Item& other) { Assign(other); return *this; }
+	Item& operator=(Item&& other) noexcept { Assign(other); return *this; }
 	virtual ~Item() { }
+
+protected:
+	Item(int id, ItemName name, int level, char grade, ItemCategory category) : id(id), name(name), level(level), grade(grade), category(category) {    }
+	Item(int id, const string& name, int level, char grade, ItemCategory category) : Item(id, ItemName(name), level, grade, category) {    }
+	Item(const Item& other, ItemCategory category) : id(other.id), name(other.name), level(other.level), grade(other.grade), category(category) {    }
+	void Assign(const Item& other) { id = other.id; name = other.name; level = other.level; grade = other.grade; }	// 태그는 그대로
 };
 class Weapon : public Item {
 public:
+	static constexpr ItemCategory kCategory = ItemCategory::Weapon;
 	int attack = 0;
-	Weapon(int id, string name, int level, char grade) : Item(id, name, level, grade) {    }
+	Weapon(int id, ItemName name, int level, char grade) : Item(id, name, level, grade, kCategory) {    }
+	Weapon(int id, const string& name, int level, char grade) : Item(id, name, level, grade, kCategory) {    }
+	Weapon(const Weapon& other) : Item(other, kCategory), attack(other.attack) {    }
+	Weapon(Weapon&& other) noexcept : Item(other, kCategory), attack(other.attack) {    }
+	Weapon& operator=(const Weapon&) = default;
+	Weapon& operator=(Weapon&&) = default;
 };
 class Armor : public Item {
 public:
+	static constexpr ItemCategory kCategory = ItemCategory::Armor;
 	int defence = 0;
-	Armor(int id, string name, int level, char grade) : Item(id, name, level, grade) {    }
+	Armor(int id, ItemName name, int level, char grade) : Item(id, name, level, grade, kCategory) {    }
+	Armor(int id, const string& name, int level, char grade) : Item(id, name, level, grade, kCategory) {    }
+	Armor(const Armor& other) : Item(other, kCategory), defence(other.defence) {    }
+	Armor(Armor&& other) noexcept : Item(other, kCategory), defence(other.defence) {    }
+	Armor& operator=(const Armor&) = default;
+	Armor& operator=(Armor&&) = default;
+};
+class Ring : public Item {
+public:
+	static constexpr ItemCategory kCategory = ItemCategory::Ring;
+	int magic = 0;
+	Ring(int id, ItemName name, int level, char grade) : Item(id, name, level, grade, kCategory) {    }
+	Ring(int id, const string& name, int level, char grade) : Item(id, name, level, grade, kCategory) {    }
+	Ring(const Ring& other) : Item(other, kCategory), magic(other.magic) {    }
+	Ring(Ring&& other) noexcept : Item(other, kCategory), magic(other.magic) {    }
+	Ring& operator=(const Ring&) = default;
+	Ring& operator=(Ring&&) = default;
+};
+
+// 종류별 수치 : Weapon 은 attack, Armor 는 defence, Ring 은 magic, Item 은 0
+inline int StatOf(const Item& item)
+{
+	switch (item.category)
+	{
+	case ItemCategory::Weapon: return static_cast<const Weapon&>(item).attack;
+	case ItemCategory::Armor: return static_cast<const Armor&>(item).defence;
+	case ItemCategory::Ring: return static_cast<const Ring&>(item).magic;
+	default: return 0;
+	}
+}
+
+// 합성 결과 등급 : 같은 등급 두 개를 합치면 한 단계 올라갑니다. (... → C → B → A → S, S 가 최고 등급)
+inline char UpgradeGrade(char grade) { return (grade == 'S' || grade == 'A') ? 'S' : grade - 1; }
+
+// 출력 형식 : Text 는 기존 PrintItems 형식("id name grade"), Csv / Tsv 는 머리줄 + id, name, level, grade
+enum class ItemFormat { Text, Csv, Tsv };
+
+// 아이템 출력기 : 고정 크기 버퍼에 글자를 직접 채우고, 버퍼가 차거나 Flush 할 때 한 번에 내보냅니다.
+//	아이템마다 힙 할당도, flush 도 없습니다. 출력 대상은 ostream(cout, ofstream) 또는 메모리(string) 입니다.
+class ItemWriter
+{
+	static constexpr size_t kBufferSize = 64 * 1024;
+	unique_ptr<char[]> buffer = make_unique<char[]>(kBufferSize);
+	size_t used = 0;
+	ostream* stream = nullptr;
+	string* memory = nullptr;
+	ItemFormat format;
+	bool headerPending;
+
+public:
+	ItemWriter(ostream& out, ItemFormat format = ItemFormat::Text) : stream(&out), format(format), headerPending(format != ItemFormat::Text) {}
+	ItemWriter(string& out, ItemFormat format = ItemFormat::Text) : memory(&out), format(format), headerPending(format != ItemFormat::Text) {}
+	~ItemWriter() { Flush(); }
+	ItemWriter(const ItemWriter&) = delete;
+	ItemWriter& operator=(const ItemWriter&) = delete;
+
+	void Write(const Item& item) { Write(item.id, item.name.str(), item.level, item.grade); }
+	void Write(int id, const string& name, int level, char grade)
+	{
+		if (headerPending)
+		{
+			headerPending = false;
+			static const string csvHeader = "id,name,level,grade\n", tsvHeader = "id\tname\tlevel\tgrade\n";
+			PutText(format == ItemFormat::Csv ? csvHeader : tsvHeader);
+		}
+		if (format == ItemFormat::Text)
+		{
+			PutInt(id); Put(' '); PutText(name); Put(' '); Put(grade); Put('\n');
+			return;
+		}
+		char separator = (format == ItemFormat::Csv) ? ',' : '\t';
+		PutInt(id); Put(separator);
+		PutField(name); Put(separator);
+		PutInt(level); Put(separator);
+		Put(grade); Put('\n');
+	}
+	void Flush()
+	{
+		if (used == 0) return;
+		if (stream) stream->write(buffer.get(), used);
+		else memory->append(buffer.get(), used);
+		used = 0;
+	}
+
+private:
+	void Put(char c)
+	{
+		if (used == kBufferSize) Flush();
+		buffer[used++] = c;
+	}
+	void Put(const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			if (used == kBufferSize) Flush();
+			size_t count = min(size, kBufferSize - used);
+			memcpy(buffer.get() + used, data, count);
+			used += count;
+			data += count;
+			size -= count;
+		}
+	}
+	void PutText(const string& text) { Put(text.data(), text.size()); }
+	void PutInt(int value)
+	{
+		char digits[16];
+		auto result = to_chars(begin(digits), end(digits), value);
+		Put(digits, result.ptr - digits);
+	}
+	// Csv 는 쉼표, 따옴표, 줄바꿈이 있으면 따옴표로 감싸고, Tsv 는 탭, 줄바꿈을 공백으로 바꿉니다.
+	void PutField(const string& text)
+	{
+		if (format == ItemFormat::Tsv)
+		{
+			for (char c : text) Put((c == '\t' || c == '\n' || c == '\r') ? ' ' : c);
+			return;
+		}
+		if (text.find_first_of(",\"\n\r") == string::npos) { PutText(text); return; }
+		Put('"');
+		for (char c : text)
+		{
+			if (c == '"') Put('"');
+			Put(c);
+		}
+		Put('"');
+	}
+};
+
+// 아이템 수가 parallelThreshold 이상일 때만 표준 실행 정책(execution::par)으로 병렬 처리합니다.
+// 기본값은 병렬을 쓰지 않는 것이고, 병렬 경로도 직렬 경로와 같은 순서를 만듭니다.
+constexpr size_t kNoParallel = SIZE_MAX;
+
+// 출력할 내용을 구간별로 나눠 병렬로 만들고, 실제 출력은 원래 순서대로 합니다. (Text 형식)
+template<typename Items, typename ToItem>
+void PrintItemsParallel(const Items& items, ToItem toItem)
+{
+	const size_t chunkSize = 4096;
+	vector<string> chunks((items.size() + chunkSize - 1) / chunkSize);
+	vector<size_t> chunkIndex(chunks.size());
+	iota(begin(chunkIndex), end(chunkIndex), 0);
+	std::for_each(execution::par, begin(chunkIndex), end(chunkIndex), [&](size_t c) {
+		ItemWriter writer(chunks[c]);
+		size_t last = min(items.size(), (c + 1) * chunkSize);
+		for (size_t i = c * chunkSize; i < last; ++i) writer.Write(toItem(items[i]));
+	});
+	for (auto& chunk : chunks) cout << chunk;
+	cout << endl;
+}
+
+// 합성 요청 하나 : 재료 id1, id2 를 합쳐 newId 아이템을 만듭니다.
+struct MergeRequest
+{
+	int id1;
+	int id2;
+	int newId;
+};
+
+// 트랜잭션 : 추가, 삭제, 합성을 차례로 모아 두었다가 ItemManager::Commit 으로 한꺼번에 적용합니다.
+//	적용하지 않고 버리려면 Discard 하거나 그냥 없애면 됩니다. 모으는 동안 매니저는 바뀌지 않습니다.
+class ItemTransaction
+{
+public:
+	enum class Op : uint8_t { Add, RemoveById, RemoveByName, Merge };
+	struct Step
+	{
+		Op op;
+		shared_ptr<Item> item;		// Add
+		MergeRequest request;		// RemoveById 는 id1 만, Merge 는 모두
+		string name;				// RemoveByName
+	};
+
+	void AddItem(shared_ptr<Item> item) { steps.push_back({ Op::Add, move(item), {}, {} }); }
+	void RemoveItemById(int id) { steps.push_back({ Op::RemoveById, nullptr, { id, 0, 0 }, {} }); }
+	void RemoveItemByName(const string& name) { steps.push_back({ Op::RemoveByName, nullptr, {}, name }); }
+	void MergeItems(int id1, int id2, int newId) { steps.push_back({ Op::Merge, nullptr, { id1, id2, newId }, {} }); }
+	void Discard() { steps.clear(); }
+
+	const vector<Step>& Steps() const { return steps; }
+	size_t Size() const { return steps.size(); }
+	bool Empty() const { return steps.empty(); }
+
+private:
+	vector<Step> steps;
+};
+
+// 아이템 전용 메모리 풀
+//	큰 덩어리(chunk)를 한 번에 받아 앞에서부터 잘라 주므로 할당은 포인터를 옮기는 것으로 끝납니다.
+//	반납된 블록은 크기별 free list 에 모았다가 같은 크기 할당에 다시 씁니다. (Weapon, Armor 등 크기는 몇 가지뿐)
+//	풀이 사라질 때 덩어리를 한꺼번에 해제합니다.
+//	할당은 한 스레드(쓰는 쪽)에서만 합니다. 반납은 어느 스레드에서 해도 되는데, 다른 스레드의 반납은
+//	잠금 없는 반납 스택에 올려 두었다가 쓰는 쪽이 다음 할당 때 free list 로 옮깁니다. (읽는 쪽이 아이템을 마지막으로 놓는 경우)
+class ItemArena
+{
+	struct FreeBlock { FreeBlock* next; };
+	struct RemoteBlock { RemoteBlock* next; size_t bytes; };		// 블록은 kAlign(16) 이상이라 두 값이 들어갑니다.
+	static constexpr size_t kChunkSize = 64 * 1024;
+	static constexpr size_t kAlign = alignof(max_align_t);
+
+	vector<unique_ptr<std::byte[]>> chunks;
+	std::byte* cursor = nullptr;
+	std::byte* limit = nullptr;
+	vector<pair<size_t, FreeBlock*>> freeLists;		// 블록 크기 -> 반납된 블록 목록
+	atomic<thread::id> owner{};						// 마지막으로 할당한 스레드
+	atomic<RemoteBlock*> remoteFrees{ nullptr };	// 다른 스레드가 반납한 블록
+
+	// 반납 목록은 그 크기를 처음 할당할 때 만들어 두므로, 반납은 할당하지 않습니다.
+	void Release(void* pointer, size_t bytes)
+	{
+		++stats.frees;
+		stats.liveBytes -= bytes;
+		auto list = find_if(begin(freeLists), end(freeLists), [&](auto& l) { return l.first == bytes; });
+		list->second = new (pointer) FreeBlock{ list->second };
+	}
+	void CollectRemoteFrees()
+	{
+		if (!remoteFrees.load(memory_order_relaxed)) return;
+		for (RemoteBlock* block = remoteFrees.exchange(nullptr, memory_order_acquire); block; )
+		{
+			RemoteBlock* next = block->next;
+			Release(block, block->bytes);
+			block = next;
+		}
+	}
+
+public:
+	struct Stats
+	{
+		size_t allocations = 0;		// 누적 할당 수
+		size_t frees = 0;			// 누적 반납 수
+		size_t reused = 0;			// free list 에서 다시 쓴 할당 수
+		size_t liveBytes = 0;		// 현재 사용 중인 바이트
+		size_t reservedBytes = 0;	// 덩어리로 받아 둔 전체 바이트
+		size_t chunkCount = 0;
+	};
+
+	ItemArena() = default;
+	ItemArena(const ItemArena&) = delete;
+	ItemArena& operator=(const ItemArena&) = delete;
+
+	void* Allocate(size_t bytes)
+	{
+		bytes = (bytes + kAlign - 1) / kAlign * kAlign;
+		if (owner.load(memory_order_relaxed) != this_thread::get_id()) owner.store(this_thread::get_id(), memory_order_relaxed);
+		CollectRemoteFrees();
+		auto list = find_if(begin(freeLists), end(freeLists), [&](auto& l) { return l.first == bytes; });
+		if (list == end(freeLists)) list = freeLists.insert(end(freeLists), { bytes, nullptr });
+		if (list->second)
+		{
+			FreeBlock* block = list->second;
+			list->second = block->next;
+			++stats.allocations;
+			stats.liveBytes += bytes;
+			++stats.reused;
+			return block;
+		}
+		if (static_cast<size_t>(limit - cursor) < bytes)
+		{
+			size_t chunkSize = max(kChunkSize, bytes);
+			unique_ptr<std::byte[]> chunk(new std::byte[chunkSize]);	// new[] 는 max_align_t 정렬을 보장합니다.
+			chunks.push_back(move(chunk));
+			cursor = chunks.back().get();
+			limit = cursor + chunkSize;
+			stats.reservedBytes += chunkSize;
+			++stats.chunkCount;
+		}
+		++stats.allocations;
+		stats.liveBytes += bytes;
+		void* block = cursor;
+		cursor += bytes;
+		return block;
+	}
+	void Deallocate(void* pointer, size_t bytes)
+	{
+		bytes = (bytes + kAlign - 1) / kAlign * kAlign;
+		if (owner.load(memory_order_relaxed) == this_thread::get_id()) { Release(pointer, bytes); return; }
+		RemoteBlock* block = new (pointer) RemoteBlock{ remoteFrees.load(memory_order_relaxed), bytes };
+		while (!remoteFrees.compare_exchange_weak(block->next, block, memory_order_release, memory_order_relaxed)) {}
+	}
+	// 쓰는 쪽 스레드에서 부릅니다. 다른 스레드의 반납은 다음 할당 때 반영됩니다.
+	const Stats& GetStats() const { return stats; }
+
+private:
+	Stats stats;
+};
+
+// allocate_shared 에 넘기는 할당자. 풀을 shared_ptr 로 잡고 있어서, 매니저가 먼저 사라져도
+// 밖에서 들고 있는 아이템이 모두 사라질 때까지 풀이 유지됩니다.
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+	shared_ptr<ItemArena> arena;
+
+	explicit ArenaAllocator(shared_ptr<ItemArena> arena) : arena(move(arena)) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n) { return static_cast<T*>(arena->Allocate(n * sizeof(T))); }
+	void deallocate(T* pointer, size_t n) { arena->Deallocate(pointer, n * sizeof(T)); }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// 아이템 핸들 : 하위 32비트는 슬롯 번호, 상위 32비트는 세대(generation)
+//	아이템이 지워지면 슬롯의 세대가 올라가므로, 예전 핸들은 참조 카운트 없이 세대 비교만으로 무효임을 알 수 있습니다.
+using ItemHandle = uint64_t;
+constexpr ItemHandle kInvalidHandle = 0;		// 세대는 1부터 시작하므로 0 은 항상 무효
+
+// 바이너리 스냅샷 형식 (버전 2, 리틀 엔디언)
+//	[SnapshotHeader][SnapshotName x nameCount][이름 바이트 nameBytes, 8바이트 경계까지 0 채움][SnapshotRecord x itemCount]
+//	레코드는 고정 크기라서 읽을 때 필드를 해석할 필요 없이 배열로 바로 씁니다.
+//	버전 2 는 버전 1 의 빈 자리에 저널 구획 번호를 적습니다. 버전 1 파일은 0 이 적혀 있어 그대로 읽습니다.
+struct SnapshotHeader
+{
+	char		magic[4];		// "ITEM"
+	uint32_t	version;
+	uint64_t	itemCount;
+	uint32_t	nameCount;
+	uint32_t	journalEpoch;	// 이 스냅샷이 담은 저널 구획, 저널 없이 저장했으면 0 (ItemJournal::StartEpoch)
+	uint64_t	nameBytes;
+};
+struct SnapshotName
+{
+	uint32_t	offset;			// 이름 바이트 안의 위치
+	uint32_t	length;
+};
+struct SnapshotRecord
+{
+	int32_t		id;
+	int32_t		level;
+	int32_t		stat;			// StatOf : Weapon 은 attack, Armor 는 defence, Ring 은 magic
+	uint32_t	name;			// 스냅샷 이름 목록의 번호
+	uint8_t		category;		// ItemCategory
+	char		grade;
+	uint16_t	reserved;
+};
+constexpr uint32_t kSnapshotVersion = 2;
+inline size_t SnapshotPadding(size_t nameBytes) { return (8 - nameBytes % 8) % 8; }
+static_assert(sizeof(SnapshotHeader) == 32 && sizeof(SnapshotRecord) == 20, "snapshot layout");
+
+// 읽기 전용 메모리 맵 파일
+class MappedFile
+{
+	const std::byte* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+
+public:
+	explicit MappedFile(const string& path)
+	{
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) return;
+		data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (data) size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0)
+		{
+			void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED)
+			{
+				madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+				data = static_cast<const std::byte*>(mapped);
+				size = info.st_size;
+			}
+		}
+		close(fd);
+#endif
+	}
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (data) munmap(const_cast<std::byte*>(data), size);
+#endif
+	}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const std::byte* Data() const { return data; }
+	size_t Size() const { return size; }
+};
+
+// 파일 내용을 디스크까지 내립니다.
+inline bool SyncFile(const string& path)
+{
+#ifdef _WIN32
+	int fd = -1;
+	if (_sopen_s(&fd, path.c_str(), _O_WRONLY | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0) return false;
+	bool synced = _commit(fd) == 0;
+	_close(fd);
+#else
+	int fd = open(path.c_str(), O_WRONLY);
+	if (fd < 0) return false;
+	bool synced = fsync(fd) == 0;
+	close(fd);
+#endif
+	return synced;
+}
+// 파일을 size 바이트로 자르고 디스크까지 내립니다.
+inline bool TruncateFile(const string& path, uint64_t size)
+{
+#ifdef _WIN32
+	int fd = -1;
+	if (_sopen_s(&fd, path.c_str(), _O_WRONLY | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0) return false;
+	bool truncated = _chsize_s(fd, static_cast<__int64>(size)) == 0 && _commit(fd) == 0;
+	_close(fd);
+#else
+	int fd = open(path.c_str(), O_WRONLY);
+	if (fd < 0) return false;
+	bool truncated = ftruncate(fd, static_cast<off_t>(size)) == 0 && fsync(fd) == 0;
+	close(fd);
+#endif
+	return truncated;
+}
+// from 을 to 로 바꿔 넣고 이름 바꾸기까지 디스크에 남깁니다. (POSIX 는 디렉터리 fsync, Windows 는 write-through 이동)
+inline bool ReplaceFileDurably(const string& from, const string& to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (rename(from.c_str(), to.c_str()) != 0) return false;
+	string directory = filesystem::path(to).parent_path().string();
+	int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	bool synced = fsync(fd) == 0;
+	close(fd);
+	return synced;
+#endif
+}
+
+// 변경 기록(저널) : ItemManager 의 변경을 작은 바이너리 레코드로 파일 끝에 덧붙입니다.
+//	레코드 : [uint32 길이][uint32 체크섬][uint8 종류][내용]  (리틀 엔디언)
+//	레코드는 메모리 버퍼에 모았다가 groupSize 개마다 한 번 write + fsync 합니다. (그룹 커밋)
+//	그래서 갑자기 종료되면 마지막으로 Flush 한 뒤의 레코드는 잃을 수 있습니다. (기본값이면 초당 10만 건일 때 최대 0.1초 정도)
+//	잃어도 되는 구간이 더 짧아야 하면 SetGroupCommit 으로 줄이고, 중요한 변경 뒤에는 Flush 를 직접 부릅니다.
+//	다시 읽을 때는 잘리거나 체크섬이 맞지 않는 레코드에서 멈춥니다. (Recover 가 그 뒤를 잘라냅니다)
+//	Log 함수는 그룹 커밋이 실패하면 false 를 돌려주고, 쓰지 못한 레코드는 버퍼에 남아 다음 Flush 에서 다시 씁니다.
+//	구획 : 스냅샷을 저장할 때마다 StartEpoch 로 구획 표시 레코드를 남기고 그 번호를 스냅샷에 적습니다.
+//	다시 적용할 때는 스냅샷의 구획 표시보다 앞의 레코드를 건너뛰므로, 스냅샷을 저장하고 저널을 비우기 전에 멈춰도 두 번 적용하지 않습니다.
+class ItemJournal
+{
+public:
+	enum class Op : uint8_t { Add = 1, RemoveById, RemoveByName, Merge, Clear, Epoch, Commit };
+
+	struct Stats
+	{
+		size_t records = 0;			// 누적 레코드 수
+		size_t flushes = 0;			// 누적 write + fsync 횟수
+		size_t bytes = 0;			// 파일에 쓴 바이트
+		size_t failedFlushes = 0;	// write 나 fsync 가 실패한 횟수
+	};
+
+	// 이어 쓸 구획 번호는 파일에 남은 마지막 구획 표시에서 읽습니다.
+	explicit ItemJournal(const string& path) : path(path)
+	{
+		ForEachRecord(path, [&](const char* body, size_t length) {
+			if (static_cast<Op>(body[0]) == Op::Epoch && length >= 1 + sizeof(uint32_t)) memcpy(&epoch, body + 1, sizeof(epoch));
+			return true;
+		});
+		fd = OpenFile(path, false);
+	}
+	~ItemJournal()
+	{
+		Flush();
+		CloseFile();
+	}
+	ItemJournal(const ItemJournal&) = delete;
+	ItemJournal& operator=(const ItemJournal&) = delete;
+
+	bool IsOpen() const { return fd >= 0; }
+	void SetGroupCommit(size_t records) { groupSize = max<size_t>(records, 1); }
+	const Stats& GetStats() const { return stats; }
+
+	bool LogAdd(const Item& item, ItemCategory category, int stat) { Begin(Op::Add, AddBytes(item)); PutAdd(item, category, stat); return End(); }
+	bool LogRemoveById(int id) { Begin(Op::RemoveById, sizeof(int32_t)); Put<int32_t>(id); return End(); }
+	bool LogRemoveByName(const string& name) { Begin(Op::RemoveByName, StringBytes(name)); PutString(name); return End(); }
+	bool LogMerge(const MergeRequest& request) { Begin(Op::Merge, 3 * sizeof(int32_t)); PutMerge(request); return End(); }
+	bool LogClear() { Begin(Op::Clear, 0); return End(); }
+	// 트랜잭션은 레코드 하나로 씁니다 : [uint32 단계 수] 뒤에 단계마다 [uint32 길이][종류][내용]
+	//	레코드째로 쓰고 읽으므로 그룹 커밋 도중에 멈춰도 트랜잭션의 일부만 남는 일이 없습니다.
+	bool LogCommit(const vector<ItemTransaction::Step>& steps)
+	{
+		size_t bodyBytes = sizeof(uint32_t);
+		for (const ItemTransaction::Step& step : steps) bodyBytes += sizeof(uint32_t) + sizeof(uint8_t) + StepBytes(step);
+		Begin(Op::Commit, bodyBytes);
+		Put<uint32_t>(static_cast<uint32_t>(steps.size()));
+		for (const ItemTransaction::Step& step : steps)
+		{
+			Put<uint32_t>(static_cast<uint32_t>(sizeof(uint8_t) + StepBytes(step)));
+			switch (step.op)
+			{
+			case ItemTransaction::Op::Add: Put<uint8_t>(static_cast<uint8_t>(Op::Add)); PutAdd(*step.item, step.item->category, StatOf(*step.item)); break;
+			case ItemTransaction::Op::RemoveById: Put<uint8_t>(static_cast<uint8_t>(Op::RemoveById)); Put<int32_t>(step.request.id1); break;
+			case ItemTransaction::Op::RemoveByName: Put<uint8_t>(static_cast<uint8_t>(Op::RemoveByName)); PutString(step.name); break;
+			case ItemTransaction::Op::Merge: Put<uint8_t>(static_cast<uint8_t>(Op::Merge)); PutMerge(step.request); break;
+			}
+		}
+		return End();
+	}
+	// 새 구획을 열고 표시를 디스크까지 내립니다. 그 앞의 레코드도 함께 내려갑니다. 새 번호는 Epoch 로 읽습니다.
+	bool StartEpoch()
+	{
+		++epoch;
+		Begin(Op::Epoch, sizeof(uint32_t));
+		Put<uint32_t>(epoch);
+		End();
+		return Flush();
+	}
+	uint32_t Epoch() const { return epoch; }
+
+	// 모아둔 레코드를 파일에 쓰고 디스크까지 내립니다. 일부만 썼으면 쓴 만큼은 버퍼에서 빼서 다시 쓰지 않습니다.
+	bool Flush()
+	{
+		if (buffer.empty()) return true;
+		if (fd < 0) return false;
+		const char* data = buffer.data();
+		size_t left = buffer.size();
+		while (left > 0)
+		{
+#ifdef _WIN32
+			int written = _write(fd, data, static_cast<unsigned>(min<size_t>(left, INT_MAX)));
+#else
+			ssize_t written = write(fd, data, left);
+#endif
+			if (written <= 0)
+			{
+				size_t done = buffer.size() - left;
+				stats.bytes += done;
+				++stats.failedFlushes;
+				buffer.erase(0, done);
+				return false;
+			}
+			data += written;
+			left -= written;
+		}
+#ifdef _WIN32
+		bool synced = _commit(fd) == 0;
+#else
+		bool synced = fsync(fd) == 0;
+#endif
+		stats.bytes += buffer.size();
+		++stats.flushes;
+		if (!synced) ++stats.failedFlushes;
+		buffer.clear();
+		pending = 0;
+		return synced;
+	}
+	// 스냅샷을 저장한 뒤 이전 기록을 비웁니다. 지금 구획 표시 하나만 담은 새 파일을 만들어 통째로 바꾸므로,
+	//	중간에 멈춰도 이전 파일이나 새 파일 중 하나가 남고, 어느 쪽이든 이어 쓸 구획 번호를 잃지 않습니다.
+	bool Truncate()
+	{
+		buffer.clear();
+		pending = 0;
+		CloseFile();
+		string temporary = path + ".tmp";
+		fd = OpenFile(temporary, true);
+		Begin(Op::Epoch, sizeof(uint32_t));
+		Put<uint32_t>(epoch);
+		End();
+		bool written = Flush();
+		CloseFile();
+		buffer.clear();
+		pending = 0;
+		bool replaced = written && ReplaceFileDurably(temporary, path);
+		if (!replaced)
+		{
+			error_code error;
+			filesystem::remove(temporary, error);
+		}
+		fd = OpenFile(path, false);
+		return replaced && fd >= 0;
+	}
+
+	// 파일의 온전한 레코드를 차례로 visit(본문, 길이) 에 넘깁니다. 본문의 첫 바이트가 종류입니다. visit 가 false 면 멈춥니다.
+	//	잘리거나 체크섬이 맞지 않는 레코드에서도 멈추고, 마지막으로 받아들인 레코드가 끝나는 위치를 돌려줍니다.
+	template<typename Visit>
+	static uint64_t ForEachRecord(const string& path, Visit visit)
+	{
+		MappedFile file(path);
+		if (!file.Data()) return 0;
+		const char* first = reinterpret_cast<const char*>(file.Data());
+		const char* at = first;
+		const char* last = at + file.Size();
+		while (static_cast<size_t>(last - at) >= 2 * sizeof(uint32_t) + 1)
+		{
+			uint32_t length, checksum;
+			memcpy(&length, at, sizeof(length));
+			memcpy(&checksum, at + sizeof(length), sizeof(checksum));
+			const char* body = at + 2 * sizeof(uint32_t);
+			if (length == 0 || static_cast<size_t>(last - body) < length || Checksum(body, length) != checksum) break;
+			if (!visit(body, static_cast<size_t>(length))) break;
+			at = body + length;
+		}
+		return at - first;
+	}
+
+	// FNV-1a 32비트, 레코드가 깨졌는지만 확인하는 용도
+	static uint32_t Checksum(const char* data, size_t size)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; ++i) hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+		return hash;
+	}
+
+private:
+	string path;
+	int fd = -1;
+	uint32_t epoch = 0;			// 지금 구획, 구획 표시를 남긴 적이 없으면 0
+	string buffer;
+	size_t recordStart = 0;
+	size_t pending = 0;
+	size_t groupSize = 8192;		// 초당 10만 건에서 저널 비용이 메모리 경로의 10% 안에 드는 크기 (BenchmarkJournal)
+	Stats stats;
+
+	char* cursor = nullptr;		// 지금 쓰는 레코드 안의 다음 쓸 위치
+
+	static int OpenFile(const string& path, bool truncate)
+	{
+		int fd = -1;
+#ifdef _WIN32
+		_sopen_s(&fd, path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY | (truncate ? _O_TRUNC : 0), _SH_DENYNO, _S_IREAD | _S_IWRITE);
+#else
+		fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), 0644);
+#endif
+		return fd;
+	}
+	void CloseFile()
+	{
+		if (fd < 0) return;
+#ifdef _WIN32
+		_close(fd);
+#else
+		close(fd);
+#endif
+		fd = -1;
+	}
+
+	// 레코드 하나의 자리를 Begin 에서 한 번에 잡고, Put 은 그 자리에 복사만 합니다.
+	template<typename T>
+	void Put(T value) { memcpy(cursor, &value, sizeof(value)); cursor += sizeof(value); }
+	static size_t StringBytes(const string& text) { return sizeof(uint16_t) + min<size_t>(text.size(), UINT16_MAX); }
+	static size_t AddBytes(const Item& item) { return sizeof(uint8_t) + 3 * sizeof(int32_t) + sizeof(char) + StringBytes(item.name.str()); }
+	static size_t StepBytes(const ItemTransaction::Step& step)
+	{
+		switch (step.op)
+		{
+		case ItemTransaction::Op::Add: return AddBytes(*step.item);
+		case ItemTransaction::Op::RemoveById: return sizeof(int32_t);
+		case ItemTransaction::Op::RemoveByName: return StringBytes(step.name);
+		case ItemTransaction::Op::Merge: return 3 * sizeof(int32_t);
+		}
+		return 0;
+	}
+	void PutString(const string& text)
+	{
+		uint16_t length = static_cast<uint16_t>(min<size_t>(text.size(), UINT16_MAX));
+		Put<uint16_t>(length);
+		memcpy(cursor, text.data(), length);
+		cursor += length;
+	}
+	void PutAdd(const Item& item, ItemCategory category, int stat)
+	{
+		Put<uint8_t>(static_cast<uint8_t>(category));
+		Put<int32_t>(item.id);
+		Put<int32_t>(item.level);
+		Put<int32_t>(stat);
+		Put<char>(item.grade);
+		PutString(item.name.str());
+	}
+	void PutMerge(const MergeRequest& request)
+	{
+		Put<int32_t>(request.id1);
+		Put<int32_t>(request.id2);
+		Put<int32_t>(request.newId);
+	}
+	void Begin(Op op, size_t bodyBytes)
+	{
+		recordStart = buffer.size();
+		buffer.resize(recordStart + 2 * sizeof(uint32_t) + sizeof(uint8_t) + bodyBytes);	// 길이, 체크섬은 End 에서 채움
+		cursor = &buffer[recordStart + 2 * sizeof(uint32_t)];
+		Put<uint8_t>(static_cast<uint8_t>(op));
+	}
+	bool End()
+	{
+		size_t bodyAt = recordStart + 2 * sizeof(uint32_t);
+		uint32_t length = static_cast<uint32_t>(buffer.size() - bodyAt);
+		uint32_t checksum = Checksum(buffer.data() + bodyAt, length);
+		memcpy(&buffer[recordStart], &length, sizeof(length));
+		memcpy(&buffer[recordStart + sizeof(length)], &checksum, sizeof(checksum));
+		++stats.records;
+		return ++pending < groupSize || Flush();
+	}
+};
+
+// 정렬 뷰 비교 함수 : 동점은 다음 키와 id 로 갈라 항상 같은 순서를 만듭니다.
+struct ItemByName
+{
+	bool operator()(const Item* a, const Item* b) const { return tie(a->name, a->id) < tie(b->name, b->id); }
+};
+struct ItemByLevel
+{
+	using is_transparent = void;		// 레벨 값만으로 lower_bound, upper_bound 를 할 수 있도록
+	bool operator()(const Item* a, const Item* b) const { return tie(a->level, a->name, a->id) < tie(b->level, b->name, b->id); }
+	bool operator()(const Item* a, int level) const { return a->level < level; }
+	bool operator()(int level, const Item* b) const { return level < b->level; }
+};
+
+// 조회 조건 : 정하지 않은 조건은 검사하지 않습니다. 조건을 이어 붙여 만듭니다.
+//	예) ItemQuery().WhereGrade('A').WhereLevel(10, 20).OrderBy(ItemQuery::Order::LevelDescending).Limit(50)
+struct ItemQuery
+{
+	enum class Order { None, Name, Level, LevelDescending };
+
+	optional<ItemCategory> category;
+	optional<string> name;
+	int minLevel = INT_MIN, maxLevel = INT_MAX;
+	optional<char> grade;
+	Order order = Order::None;
+	size_t maxCount = SIZE_MAX;
+
+	ItemQuery& WhereCategory(ItemCategory value) { category = value; return *this; }
+	ItemQuery& WhereName(const string& value) { name = value; return *this; }
+	ItemQuery& WhereLevel(int low, int high) { minLevel = low; maxLevel = high; return *this; }
+	ItemQuery& WhereGrade(char value) { grade = value; return *this; }
+	ItemQuery& OrderBy(Order value) { order = value; return *this; }
+	ItemQuery& Limit(size_t count) { maxCount = count; return *this; }
+
+	bool HasLevelRange() const { return minLevel != INT_MIN || maxLevel != INT_MAX; }
 };
 
-class ItemManager
-{
-	vector<shared_ptr<Item>> itemlist;
+// 목록의 읽기 전용 버전 : 읽는 쪽은 잠금 없이 받아 마음대로 순회하고, 다 쓰면 놓기만 하면 됩니다.
+//	아이템을 복사해 들고 있다가 읽는 쪽에서 마지막으로 놓아도 됩니다. (풀의 반납 스택을 거쳐 쓰는 쪽으로 돌아갑니다)
+using ItemListVersion = shared_ptr<const vector<shared_ptr<const Item>>>;
+
+// 조각 단위 copy-on-write 목록 : kChunkSize 개씩 나눈 조각과 조각 표를 shared_ptr 로 나눠 가집니다.
+//	복사는 조각 표 포인터만 복사하므로 O(1) 이고, 복사본이 살아 있는 동안 쓰면 처음 한 번 조각 표(조각 수만큼의 포인터)를,
+//	그리고 건드린 조각만 복사합니다. 읽기는 operator[] 와 반복자, 쓰기는 Mutable, push_back, Truncate 로만 합니다.
+class ChunkedItemList
+{
+public:
+	static constexpr size_t kChunkShift = 10;
+	static constexpr size_t kChunkSize = size_t(1) << kChunkShift;
+	using Chunk = array<shared_ptr<Item>, kChunkSize>;
+	using Table = vector<shared_ptr<Chunk>>;
+
+	class const_iterator
+	{
+		const ChunkedItemList* list = nullptr;
+		size_t index = 0;
+	public:
+		using iterator_category = random_access_iterator_tag;
+		using value_type = shared_ptr<Item>;
+		using difference_type = ptrdiff_t;
+		using pointer = const shared_ptr<Item>*;
+		using reference = const shared_ptr<Item>&;
+
+		const_iterator() = default;
+		const_iterator(const ChunkedItemList* list, size_t index) : list(list), index(index) {}
+		reference operator*() const { return (*list)[index]; }
+		pointer operator->() const { return &(*list)[index]; }
+		reference operator[](difference_type n) const { return (*list)[index + n]; }
+		const_iterator& operator++() { ++index; return *this; }
+		const_iterator operator++(int) { auto old = *this; ++index; return old; }
+		const_iterator& operator--() { --index; return *this; }
+		const_iterator operator--(int) { auto old = *this; --index; return old; }
+		const_iterator& operator+=(difference_type n) { index += n; return *this; }
+		const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+		friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+		friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+		friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+		friend difference_type operator-(const const_iterator& a, const const_iterator& b) { return difference_type(a.index) - difference_type(b.index); }
+		friend bool operator==(const const_iterator& a, const const_iterator& b) { return a.index == b.index; }
+		friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a.index != b.index; }
+		friend bool operator<(const const_iterator& a, const const_iterator& b) { return a.index < b.index; }
+		friend bool operator>(const const_iterator& a, const const_iterator& b) { return a.index > b.index; }
+		friend bool operator<=(const const_iterator& a, const const_iterator& b) { return a.index <= b.index; }
+		friend bool operator>=(const const_iterator& a, const const_iterator& b) { return a.index >= b.index; }
+	};
+
+private:
+	shared_ptr<Table> table = make_shared<Table>();
+	size_t count = 0;
+
+	// 다른 복사본과 나눠 쓰고 있으면 먼저 복사합니다. use_count 가 1 이면 다른 스레드가 놓은 뒤이므로 acquire 로 그 읽기를 앞에 둡니다.
+	template<typename T>
+	static T& Own(shared_ptr<T>& shared)
+	{
+		if (shared.use_count() != 1) shared = make_shared<T>(*shared);
+		else atomic_thread_fence(memory_order_acquire);
+		return *shared;
+	}
+
+public:
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	size_t capacity() const { return table->size() * kChunkSize; }		// 이미 만든 조각의 자리 수
+	size_t ChunkCount() const { return table->size(); }
+	// 조각 표만 미리 잡습니다. 조각은 필요할 때 하나씩 만듭니다.
+	void reserve(size_t size) { if (size > table->capacity() * kChunkSize) Own(table).reserve((size + kChunkSize - 1) >> kChunkShift); }
+	size_t TableBytes() const { return table->capacity() * sizeof(shared_ptr<Chunk>); }
+
+	// 쓰기 전에 할당을 끝내 둡니다. 할당이 실패해도 내용은 그대로입니다.
+	//	OwnRange(first, last) 뒤에는 그 구간의 Mutable, Truncate 가, ReserveChunks(size) 뒤에는 size 개까지의 push_back 이 할당하지 않습니다.
+	void OwnRange(size_t first, size_t last)
+	{
+		Table& owned = Own(table);
+		for (size_t c = first >> kChunkShift; c < owned.size() && (c << kChunkShift) < last; ++c) Own(owned[c]);
+	}
+	void ReserveChunks(size_t size)
+	{
+		Table& owned = Own(table);
+		size_t chunks = (size + kChunkSize - 1) >> kChunkShift;
+		if (chunks > owned.capacity()) owned.reserve(max(chunks, 2 * owned.capacity()));
+		while (owned.size() < chunks) owned.push_back(make_shared<Chunk>());
+		OwnRange(count, size);
+	}
+
+	const shared_ptr<Item>& operator[](size_t i) const { return (*(*table)[i >> kChunkShift])[i & (kChunkSize - 1)]; }
+	shared_ptr<Item>& Mutable(size_t i) { return Own(Own(table)[i >> kChunkShift])[i & (kChunkSize - 1)]; }
+	void push_back(shared_ptr<Item> item)
+	{
+		if (count == table->size() * kChunkSize) Own(table).push_back(make_shared<Chunk>());
+		Mutable(count++) = move(item);
+	}
+	// 앞의 size 개만 남깁니다. 통째로 빠지는 조각은 표에서 빼기만 하고, 걸친 조각만 뒷부분을 비웁니다.
+	void Truncate(size_t size)
+	{
+		if (size >= count) return;
+		for (size_t i = size; i < count && (i & (kChunkSize - 1)) != 0; ++i) Mutable(i).reset();
+		Own(table).resize((size + kChunkSize - 1) >> kChunkShift);
+		count = size;
+	}
+	void clear() { table = make_shared<Table>(); count = 0; }
+	void swap(ChunkedItemList& other) { table.swap(other.table); std::swap(count, other.count); }
+
+	// 조각 단위로 훑습니다. 반복자보다 주소 계산이 적습니다.
+	template<typename Visit>
+	void ForEach(Visit visit) const
+	{
+		for (size_t c = 0, left = count; left > 0; ++c)
+		{
+			const Chunk& chunk = *(*table)[c];
+			size_t n = min(left, kChunkSize);
+			for (size_t i = 0; i < n; ++i) visit(chunk[i]);
+			left -= n;
+		}
+	}
+	const_iterator begin() const { return { this, 0 }; }
+	const_iterator end() const { return { this, count }; }
+};
+// 저장용으로 얼려 둔 목록 : 만든 뒤로는 아무도 바꾸지 않으므로 다른 스레드에서 잠금 없이 읽을 수 있습니다.
+using ItemListSnapshot = shared_ptr<const ChunkedItemList>;
+
+// 색인에 쓰이는 id, name, level, grade 는 아이템을 추가한 뒤 매니저 밖에서 바꾸지 않는다고 가정합니다.
+class ItemManager
+{
+	ChunkedItemList itemlist;
+	unordered_map<int, size_t> idIndex;		// id -> itemlist 위치, id 는 중복되지 않는다고 가정
+	vector<unordered_set<int>> nameIndex;	// 이름 심볼 -> 그 이름을 가진 아이템 id 들
+	set<const Item*, ItemByName> byName;	// 추가, 삭제 때마다 갱신되는 정렬 뷰
+	set<const Item*, ItemByLevel> byLevel;
+	map<char, set<const Item*, ItemByLevel>> byGradeLevel;		// 등급별 레벨 순 뷰
+	array<set<const Item*, ItemByLevel>, kItemCategoryCount> byCategoryLevel;		// 종류별 레벨 순 뷰
+	size_t parallelThreshold = kNoParallel;
+	shared_ptr<ItemArena> arena = make_shared<ItemArena>();
+	ItemJournal* journal = nullptr;			// 연결되어 있으면 공개 변경 함수가 기록을 남깁니다.
+	bool journalFailed = false;				// 기록이 한 번이라도 디스크에 내려가지 못했으면 true (HasJournalError)
+
+	// 발행된 버전 : atomic_load / atomic_store 로만 읽고 씁니다.
+	// 지난 버전은 retired 에 두었다가 읽는 쪽이 모두 놓으면 쓰는 쪽 스레드에서 해제합니다. (대부분의 반납이 반납 스택을 거치지 않도록)
+	ItemListVersion published = make_shared<const vector<shared_ptr<const Item>>>();
+	vector<ItemListVersion> retired;
+	uint64_t changes = 0, publishedChanges = 0;		// 목록이 바뀐 횟수, 발행 때의 횟수
+
+	// 저장용 스냅샷 : 만든 스냅샷은 frozen 에도 들고 있다가 밖에서 모두 놓으면 쓰는 쪽 스레드에서 해제합니다. (지운 아이템이 반납 스택 없이 바로 풀로 돌아가도록)
+	vector<ItemListSnapshot> frozen;
+
+	struct Slot
+	{
+		uint32_t generation = 1;
+		uint32_t position = 0;		// itemlist 위치
+	};
+	vector<Slot> slots;
+	vector<uint32_t> freeSlots;
+	vector<uint32_t> slotOf;		// itemlist 위치 -> 슬롯 번호, itemlist 와 같은 순서로 움직입니다.
+
+	// 지연 삭제 : 지운 자리는 nullptr(묘비)로 남겨 두고, 묘비 비율이 maxDeadRatio 를 넘을 때 한 번에 압축합니다.
+	//	maxDeadRatio 가 0 이면 지울 때마다 바로 압축합니다. 목록 전체를 훑는 함수는 묘비를 건너뜁니다.
+//	기본값은 지연 삭제라서 id 삭제는 상각 O(1) 입니다. (압축 한 번의 비용을 그 사이의 삭제들이 나눠 냅니다)
+public:
+	struct CompactionStats
+	{
+		size_t tombstones = 0;			// 지금 남아 있는 묘비 수
+		size_t compactions = 0;
+		size_t reclaimed = 0;			// 압축으로 없앤 묘비 수 (누적)
+		size_t moved = 0;				// 압축으로 자리를 옮긴 아이템 수 (누적)
+		double totalMs = 0;				// 압축에 쓴 시간 (누적)
+	};
+private:
+	double maxDeadRatio = 0.25;
+	size_t firstDead = SIZE_MAX;		// 가장 앞쪽 묘비 위치
+	CompactionStats compaction;
+
+	// 계측 : 공개 변경 함수마다 호출 수와 그동안의 할당, 해제 횟수를 작업 종류별로 모읍니다. (할당, 해제는 ITEM_COUNT_ALLOCATIONS 일 때만)
+public:
+	enum class ItemOp : uint8_t { Add, Remove, Merge, Sort, Load, Publish, Compact, Commit, Snapshot };
+	static constexpr size_t kItemOpCount = 9;
+	static const char* OpName(ItemOp op)
+	{
+		static const char* names[kItemOpCount] = { "add", "remove", "merge", "sort", "load", "publish", "compact", "commit", "snapshot" };
+		return names[static_cast<size_t>(op)];
+	}
+	struct OpCounters
+	{
+		uint64_t calls = 0;
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t allocatedBytes = 0;
+	};
+	using StatsExporter = function<void(const ItemManager&)>;
+private:
+	array<OpCounters, kItemOpCount> opCounters{};
+	int opDepth = 0;					// 공개 함수 안에서 다른 공개 함수를 부르면 바깥 작업으로만 셉니다.
+	StatsExporter exporter;
+	chrono::steady_clock::duration exportInterval{};
+	chrono::steady_clock::time_point lastExport;
+
+	class OpScope
+	{
+		ItemManager& manager;
+		ItemOp op;
+		AllocationCounter start;
+	public:
+		OpScope(ItemManager& manager, ItemOp op) : manager(manager), op(op), start(ThreadAllocations()) { ++manager.opDepth; }
+		~OpScope() { if (--manager.opDepth == 0) { manager.ReleaseSnapshots(); manager.RecordOp(op, start); } }
+	};
+	void RecordOp(ItemOp op, const AllocationCounter& start)
+	{
+		const AllocationCounter& now = ThreadAllocations();
+		OpCounters& counters = opCounters[static_cast<size_t>(op)];
+		++counters.calls;
+		counters.allocations += now.allocations - start.allocations;
+		counters.frees += now.frees - start.frees;
+		counters.allocatedBytes += now.bytes - start.bytes;
+		if (exporter && chrono::steady_clock::now() - lastExport >= exportInterval)
+		{
+			lastExport = chrono::steady_clock::now();
+			exporter(*this);
+		}
+	}
+
+	ItemHandle AcquireSlot(size_t position)
+	{
+		uint32_t slot;
+		if (!freeSlots.empty()) { slot = freeSlots.back(); freeSlots.pop_back(); }
+		else { slot = static_cast<uint32_t>(slots.size()); slots.emplace_back(); }
+		slots[slot].position = static_cast<uint32_t>(position);
+		slotOf.push_back(slot);
+		return (static_cast<uint64_t>(slots[slot].generation) << 32) | slot;
+	}
+	void ReleaseSlot(uint32_t slot)
+	{
+		++slots[slot].generation;
+		freeSlots.push_back(slot);
+	}
+	// 핸들이 가리키는 아이템의 itemlist 위치, 무효한 핸들이면 SIZE_MAX
+	size_t PositionOf(ItemHandle handle) const
+	{
+		uint32_t slot = static_cast<uint32_t>(handle);
+		uint32_t generation = static_cast<uint32_t>(handle >> 32);
+		if (slot >= slots.size() || slots[slot].generation != generation) return SIZE_MAX;
+		return slots[slot].position;
+	}
+
+	// 색인 노드를 넣다가 할당이 실패하면 넣은 것을 도로 빼고 다시 던집니다.
+	void IndexItem(const Item& item)
+	{
+		uint32_t symbol = item.name.Symbol();
+		if (symbol >= nameIndex.size()) nameIndex.resize(symbol + 1);
+		auto& gradeView = byGradeLevel[item.grade];
+		nameIndex[symbol].insert(item.id);
+		try
+		{
+			byName.insert(&item);
+			byLevel.insert(&item);
+			gradeView.insert(&item);
+			byCategoryLevel[static_cast<size_t>(item.category)].insert(&item);
+		}
+		catch (...)
+		{
+			UnindexItem(item);		// 아직 넣지 못한 뷰에서는 지울 것이 없습니다.
+			throw;
+		}
+	}
+	void UnindexItem(const Item& item)
+	{
+		nameIndex[item.name.Symbol()].erase(item.id);
+		byName.erase(&item);
+		byLevel.erase(&item);
+		byGradeLevel[item.grade].erase(&item);
+		byCategoryLevel[static_cast<size_t>(item.category)].erase(&item);
+	}
+
+	// 하나씩 늘릴 때도 용량은 두 배씩 늘도록 자리를 잡습니다.
+	template<typename T>
+	static void ReserveMore(vector<T>& values, size_t extra)
+	{
+		if (values.capacity() - values.size() < extra) values.reserve(max(values.size() + extra, 2 * values.capacity()));
+	}
+	template<typename Hashed>
+	static void ReserveMore(Hashed& values, size_t extra)
+	{
+		if (values.size() + extra > values.bucket_count() * values.max_load_factor()) values.reserve(values.size() + extra);
+	}
+
+	// 오름차순으로 정렬된 위치의 아이템을 지웁니다. 색인에서 빼고 자리는 묘비로 남긴 뒤, 묘비가 많으면 압축합니다.
+	//	쓸 조각과 반납할 슬롯 자리를 먼저 잡아 두므로, 할당이 실패하면 아무것도 지우지 않습니다.
+	void EraseAt(const vector<size_t>& positions)
+	{
+		if (positions.empty()) return;
+		bool compact = compaction.tombstones + positions.size() > maxDeadRatio * itemlist.size();
+		PrepareErase(positions, compact, itemlist.size());
+		Unlink(positions);
+		if (compact) Compact();
+	}
+	// listSize 는 압축할 때의 목록 크기입니다. (Commit 은 새 아이템을 붙인 뒤에 압축합니다)
+	void PrepareErase(const vector<size_t>& positions, bool compact, size_t listSize)
+	{
+		if (compact) itemlist.OwnRange(min(firstDead, positions.front()), listSize);
+		else for (size_t i : positions) itemlist.OwnRange(i, i + 1);
+		ReserveMore(freeSlots, positions.size());
+	}
+	// PrepareErase 뒤에 부르면 할당하지 않습니다.
+	void Unlink(const vector<size_t>& positions)
+	{
+		++changes;
+		for (size_t i : positions)
+		{
+			idIndex.erase(itemlist[i]->id);
+			UnindexItem(*itemlist[i]);
+			ReleaseSlot(slotOf[i]);
+			itemlist.Mutable(i).reset();
+		}
+		compaction.tombstones += positions.size();
+		firstDead = min(firstDead, positions.front());
+	}
+	// 첫 묘비 앞쪽은 건드리지 않고, 그 뒤 구간만 한 번 당겨오면서 위치를 다시 색인합니다. 목록 순서는 그대로입니다.
+	void CompactTombstones()
+	{
+		auto start = chrono::steady_clock::now();
+		size_t out = firstDead;
+		for (size_t i = firstDead; i < itemlist.size(); ++i)
+		{
+			if (!itemlist[i]) continue;
+			if (out != i)
+			{
+				itemlist.Mutable(out) = move(itemlist.Mutable(i));
+				slotOf[out] = slotOf[i];
+				++compaction.moved;
+			}
+			idIndex[itemlist[out]->id] = out;
+			slots[slotOf[out]].position = static_cast<uint32_t>(out);
+			++out;
+		}
+		itemlist.Truncate(out);
+		slotOf.resize(out);
+		++compaction.compactions;
+		compaction.reclaimed += compaction.tombstones;
+		compaction.tombstones = 0;
+		firstDead = SIZE_MAX;
+		compaction.totalMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+	size_t LiveCount() const { return itemlist.size() - compaction.tombstones; }
+	// 정렬 뷰의 순서대로 itemlist 를 다시 배치합니다. 비교 없이 O(n) 입니다.
+	template<typename View>
+	void ArrangeBy(const View& view)
+	{
+		++changes;
+		ChunkedItemList arranged;
+		vector<uint32_t> arrangedSlots;
+		arranged.reserve(itemlist.size());
+		arrangedSlots.reserve(itemlist.size());
+		for (const Item* item : view)
+		{
+			size_t from = idIndex[item->id];
+			arranged.push_back(itemlist[from]);
+			arrangedSlots.push_back(slotOf[from]);
+		}
+		itemlist.swap(arranged);
+		slotOf.swap(arrangedSlots);
+		compaction.reclaimed += compaction.tombstones;		// 뷰에는 살아 있는 아이템만 있으므로 묘비도 함께 사라집니다.
+		compaction.tombstones = 0;
+		firstDead = SIZE_MAX;
+		for (size_t i = 0; i < itemlist.size(); ++i)
+		{
+			idIndex[itemlist[i]->id] = i;
+			slots[slotOf[i]].position = static_cast<uint32_t>(i);
+		}
+	}
+
+	// 기록을 남기지 않고 목록을 비웁니다. (스냅샷 읽기, 저널 다시 적용)
+	void Reset()
+	{
+		++changes;
+		for (size_t i = 0; i < slotOf.size(); ++i) if (itemlist[i]) ReleaseSlot(slotOf[i]);		// 묘비 슬롯은 EraseAt 에서 이미 놓았습니다.
+		itemlist.clear();
+		compaction.tombstones = 0;
+		firstDead = SIZE_MAX;
+		idIndex.clear();
+		nameIndex.clear();
+		byName.clear();
+		byLevel.clear();
+		byGradeLevel.clear();
+		for (auto& view : byCategoryLevel) view.clear();
+		slotOf.clear();
+		arena = make_shared<ItemArena>();
+	}
+	// 할당은 모두 목록을 바꾸기 전에 합니다. 실패하면 넣은 id 를 도로 빼고 다시 던지므로 매니저는 그대로입니다.
+	ItemHandle Insert(const shared_ptr<Item>& item)
+	{
+		auto added = idIndex.emplace(item->id, itemlist.size());
+		if (!added.second) return kInvalidHandle;
+		try
+		{
+			itemlist.ReserveChunks(itemlist.size() + 1);
+			ReserveMore(slots, 1);
+			ReserveMore(slotOf, 1);
+			IndexItem(*item);
+		}
+		catch (...)
+		{
+			idIndex.erase(added.first);
+			throw;
+		}
+		++changes;
+		itemlist.push_back(item);
+		return AcquireSlot(itemlist.size() - 1);
+	}
+	// Commit 이 반영 전에 만들어 두는 색인 노드 : 반영할 때는 노드를 끼우기만 하므로 할당하지 않습니다.
+	struct StagedNodes
+	{
+		vector<unordered_map<int, size_t>::node_type> ids;
+		vector<unordered_set<int>::node_type> names;
+		vector<set<const Item*, ItemByName>::node_type> byName;
+		vector<set<const Item*, ItemByLevel>::node_type> byLevel, byGrade, byCategory;
+	};
+	// 노드를 만들고, 넣을 이름 색인과 등급별 뷰의 자리도 잡아 둡니다. (빈 색인, 빈 뷰는 조회 결과에 보이지 않습니다)
+	StagedNodes StageNodes(const vector<shared_ptr<Item>>& items)
+	{
+		StagedNodes nodes;
+		nodes.ids.reserve(items.size());
+		nodes.names.reserve(items.size());
+		nodes.byName.reserve(items.size());
+		nodes.byLevel.reserve(items.size());
+		nodes.byGrade.reserve(items.size());
+		nodes.byCategory.reserve(items.size());
+		unordered_map<int, size_t> stagingIds;
+		unordered_set<int> stagingNames;
+		set<const Item*, ItemByName> stagingByName;
+		set<const Item*, ItemByLevel> stagingByLevel;
+		unordered_map<uint32_t, size_t> perName;
+		for (auto& item : items)
+		{
+			nodes.ids.push_back(stagingIds.extract(stagingIds.emplace(item->id, 0).first));
+			nodes.names.push_back(stagingNames.extract(stagingNames.insert(item->id).first));
+			nodes.byName.push_back(stagingByName.extract(stagingByName.insert(item.get()).first));
+			nodes.byLevel.push_back(stagingByLevel.extract(stagingByLevel.insert(item.get()).first));
+			nodes.byGrade.push_back(stagingByLevel.extract(stagingByLevel.insert(item.get()).first));
+			nodes.byCategory.push_back(stagingByLevel.extract(stagingByLevel.insert(item.get()).first));
+			byGradeLevel[item->grade];
+			++perName[item->name.Symbol()];
+		}
+		for (auto& entry : perName)
+		{
+			if (entry.first >= nameIndex.size()) nameIndex.resize(entry.first + 1);
+			ReserveMore(nameIndex[entry.first], entry.second);
+		}
+		return nodes;
+	}
+	// 목록, 슬롯 자리와 id 색인을 미리 잡았으면 할당하지 않습니다.
+	void InsertStaged(const shared_ptr<Item>& item, StagedNodes& nodes, size_t i)
+	{
+		++changes;
+		nodes.ids[i].mapped() = itemlist.size();
+		idIndex.insert(move(nodes.ids[i]));
+		itemlist.push_back(item);
+		nameIndex[item->name.Symbol()].insert(move(nodes.names[i]));
+		byName.insert(move(nodes.byName[i]));
+		byLevel.insert(move(nodes.byLevel[i]));
+		byGradeLevel[item->grade].insert(move(nodes.byGrade[i]));
+		byCategoryLevel[static_cast<size_t>(item->category)].insert(move(nodes.byCategory[i]));
+		AcquireSlot(itemlist.size() - 1);
+	}
+	// 빈 목록에 한꺼번에 넣습니다. 정렬 뷰는 한 번 정렬한 순서대로 끝 위치 힌트를 주고 넣으므로 아이템마다 트리를 찾아 내려가지 않습니다.
+	//	정렬은 뷰의 비교 함수와 같은 순서를 만드는 정수 키로 합니다. (비교마다 이름 순위를 찾거나 아이템을 따라가지 않도록)
+	//	같은 id 가 다시 나오면 Insert 처럼 뒤의 것을 버립니다.
+	void InsertAll(const vector<shared_ptr<Item>>& items)
+	{
+		struct SortKey
+		{
+			uint64_t key;
+			uint32_t tie;
+			const Item* item;
+			bool operator<(const SortKey& other) const { return key != other.key ? key < other.key : tie < other.tie; }
+		};
+		auto ordered = [](int value) { return static_cast<uint32_t>(value) ^ 0x80000000u; };		// 부호 있는 값을 부호 없는 순서로
+
+		++changes;
+		vector<uint32_t> ranks = ItemNames().Ranks();		// 아이템들의 이름은 모두 이미 등록되어 있습니다.
+		vector<SortKey> sorted;
+		sorted.reserve(items.size());
+		for (auto& item : items)
+		{
+			if (!idIndex.emplace(item->id, itemlist.size()).second) continue;
+			itemlist.push_back(item);
+			AcquireSlot(itemlist.size() - 1);
+			uint32_t symbol = item->name.Symbol();
+			if (symbol >= nameIndex.size()) nameIndex.resize(symbol + 1);
+			nameIndex[symbol].insert(item->id);
+			sorted.push_back({ (uint64_t(ranks[symbol]) << 32) | ordered(item->id), 0, item.get() });		// 이름, id
+		}
+		std::sort(begin(sorted), end(sorted));
+		for (auto& entry : sorted) byName.insert(end(byName), entry.item);
+		for (auto& entry : sorted)		// 레벨, 이름, id
+		{
+			uint32_t rank = static_cast<uint32_t>(entry.key >> 32);
+			entry = { (uint64_t(ordered(entry.item->level)) << 32) | rank, ordered(entry.item->id), entry.item };
+		}
+		std::sort(begin(sorted), end(sorted));
+		for (auto& entry : sorted)
+		{
+			const Item* item = entry.item;
+			byLevel.insert(end(byLevel), item);
+			auto& gradeView = byGradeLevel[item->grade];
+			gradeView.insert(end(gradeView), item);
+			auto& categoryView = byCategoryLevel[static_cast<size_t>(item->category)];
+			categoryView.insert(end(categoryView), item);
+		}
+	}
+	void LogAdd(const Item& item)
+	{
+		Journaled(journal->LogAdd(item, item.category, StatOf(item)));
+	}
+	// Log 함수의 결과를 받아 실패를 기억합니다. 변경은 이미 반영되었으므로 되돌리지 않습니다.
+	void Journaled(bool written)
+	{
+		if (!written) journalFailed = true;
+	}
+	// 스냅샷에 적을 저널 구획을 엽니다. 저널이 없으면 0 이고, 구획 표시를 디스크에 내리지 못하면 false.
+	bool StartJournalEpoch(uint32_t& epoch)
+	{
+		epoch = 0;
+		if (!journal) return true;
+		if (!journal->StartEpoch()) { journalFailed = true; return false; }
+		epoch = journal->Epoch();
+		return true;
+	}
+	// 저널 레코드 하나를 적용합니다. 내용이 모자라면 false. checkOnly 면 읽기만 하고 적용하지 않습니다.
+	bool ApplyJournalRecord(const char* body, size_t length, bool checkOnly = false)
+	{
+		size_t offset = 1;
+		auto get = [&](auto& value) {
+			if (offset + sizeof(value) > length) return false;
+			memcpy(&value, body + offset, sizeof(value));
+			offset += sizeof(value);
+			return true;
+		};
+		auto getString = [&](string& text) {
+			uint16_t size;
+			if (!get(size) || offset + size > length) return false;
+			text.assign(body + offset, size);
+			offset += size;
+			return true;
+		};
+
+		switch (static_cast<ItemJournal::Op>(body[0]))
+		{
+		case ItemJournal::Op::Add:
+		{
+			uint8_t category; int32_t id, level, stat; char grade; string name;
+			if (!get(category) || !get(id) || !get(level) || !get(stat) || !get(grade) || !getString(name) || category >= kItemCategoryCount) return false;
+			if (!checkOnly) Insert(MakeItemOf(static_cast<ItemCategory>(category), id, ItemName(name), level, grade, stat));
+			return true;
+		}
+		case ItemJournal::Op::RemoveById:
+		{
+			int32_t id;
+			if (!get(id)) return false;
+			if (!checkOnly) RemoveItemById(id);
+			return true;
+		}
+		case ItemJournal::Op::RemoveByName:
+		{
+			string name;
+			if (!getString(name)) return false;
+			if (!checkOnly) RemoveItemByName(name);
+			return true;
+		}
+		case ItemJournal::Op::Merge:
+		{
+			MergeRequest request;
+			if (!get(request.id1) || !get(request.id2) || !get(request.newId)) return false;
+			if (!checkOnly) MergeItems(vector<MergeRequest>{ request });
+			return true;
+		}
+		case ItemJournal::Op::Clear:
+			if (!checkOnly) Reset();
+			return true;
+		case ItemJournal::Op::Epoch:		// 구획은 ReplayJournal 이 따로 읽습니다.
+		{
+			uint32_t epoch;
+			return get(epoch);
+		}
+		case ItemJournal::Op::Commit:		// 모든 단계를 먼저 읽어 본 뒤에 차례로 적용합니다. 결과는 Commit 과 같습니다.
+		{
+			uint32_t count;
+			if (!get(count)) return false;
+			size_t steps = offset;
+			for (bool apply : { false, true })
+			{
+				if (apply && checkOnly) break;
+				offset = steps;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					uint32_t stepLength;
+					if (!get(stepLength) || stepLength == 0 || offset + stepLength > length) return false;
+					auto op = static_cast<ItemJournal::Op>(body[offset]);
+					if (op != ItemJournal::Op::Add && op != ItemJournal::Op::RemoveById && op != ItemJournal::Op::RemoveByName && op != ItemJournal::Op::Merge) return false;
+					if (!ApplyJournalRecord(body + offset, stepLength, !apply)) return false;
+					offset += stepLength;
+				}
+			}
+			return true;
+		}
+		}
+		return false;
+	}
+
+	// 저장된 종류와 수치로 아이템을 다시 만듭니다. (스냅샷, 저널)
+	shared_ptr<Item> MakeItemOf(ItemCategory category, int id, ItemName name, int level, char grade, int stat)
+	{
+		switch (category)
+		{
+		case ItemCategory::Weapon: { auto weapon = MakeItem<Weapon>(id, name, level, grade); weapon->attack = stat; return weapon; }
+		case ItemCategory::Armor: { auto armor = MakeItem<Armor>(id, name, level, grade); armor->defence = stat; return armor; }
+		case ItemCategory::Ring: { auto ring = MakeItem<Ring>(id, name, level, grade); ring->magic = stat; return ring; }
+		default: return MakeItem<Item>(id, name, level, grade);
+		}
+	}
+	// 후보를 고른 색인이 이미 확인한 조건도 다시 검사합니다. 싼 조건부터.
+	static bool Matches(const ItemQuery& query, const Item& item, uint32_t nameSymbol)
+	{
+		if (item.level < query.minLevel || item.level > query.maxLevel) return false;
+		if (query.grade && item.grade != *query.grade) return false;
+		if (query.name && item.name.Symbol() != nameSymbol) return false;
+		return !query.category || item.category == *query.category;
+	}
+	// 정렬 뷰의 레벨 구간 [low, high] 을 차례로, 또는 거꾸로 넘겨줍니다. visit 가 false 면 멈춥니다.
+	template<typename Visit>
+	static void ScanLevels(const set<const Item*, ItemByLevel>& view, int low, int high, bool descending, Visit visit)
+	{
+		if (low > high) return;
+		auto first = view.lower_bound(low), last = view.upper_bound(high);
+		if (descending) { for (auto it = make_reverse_iterator(last); it != make_reverse_iterator(first); ++it) if (!visit(*it)) return; }
+		else { for (auto it = first; it != last; ++it) if (!visit(*it)) return; }
+	}
+
+	static vector<const Item*> LevelRange(const set<const Item*, ItemByLevel>& view, int minLevel, int maxLevel)
+	{
+		vector<const Item*> items;
+		if (minLevel > maxLevel) return items;
+		items.assign(view.lower_bound(minLevel), view.upper_bound(maxLevel));
+		return items;
+	}
+	static vector<const Item*> Top(const set<const Item*, ItemByLevel>& view, size_t k)
+	{
+		vector<const Item*> items;
+		items.reserve(min(k, view.size()));
+		for (auto it = view.rbegin(); it != view.rend() && items.size() < k; ++it) items.push_back(*it);
+		return items;
+	}
+
+public:
+	void SetParallelThreshold(size_t count) { parallelThreshold = count; }
+
+	// 매니저의 풀에서 아이템을 만듭니다. make_shared 대신 쓰면 개별 힙 할당이 없습니다.
+	template<typename T, typename... Args>
+	shared_ptr<T> MakeItem(Args&&... args)
+	{
+		return allocate_shared<T>(ArenaAllocator<T>(arena), forward<Args>(args)...);
+	}
+	const ItemArena::Stats& AllocatorStats() const { return arena->GetStats(); }
+
+	// 묘비 비율이 ratio 를 넘으면 압축합니다. (기본값 0.25) 0 이면 지울 때마다 바로 압축합니다.
+	void SetMaxDeadRatio(double ratio)
+	{
+		maxDeadRatio = ratio;
+		if (compaction.tombstones > maxDeadRatio * itemlist.size()) Compact();
+	}
+	// 남은 묘비를 지금 압축합니다. 한가한 틈(프레임 끝 등)에 불러 두면 삭제 중에 압축이 일어나는 일이 줄어듭니다.
+	void Compact()
+	{
+		OpScope scope(*this, ItemOp::Compact);
+		if (compaction.tombstones > 0) CompactTombstones();
+	}
+	const CompactionStats& GetCompactionStats() const { return compaction; }
+
+	// 메모리 사용량 : 아이템 수는 정확하고, 노드와 제어 블록 크기는 표준 라이브러리 구현에 따른 추정값입니다.
+	//	아이템 수와 용량만 읽으므로 아이템 수와 무관하게 O(1) 입니다. (전역 이름 테이블은 이름 수에 비례)
+	struct MemoryUsage
+	{
+		size_t liveItems = 0;
+		size_t tombstones = 0;
+		array<size_t, kItemCategoryCount> itemsByCategory{};
+		array<size_t, kItemCategoryCount> bytesByCategory{};	// 객체 + shared_ptr 제어 블록
+		size_t listBytes = 0;			// itemlist(조각, 조각 표), 슬롯 배열, 발행된 버전 (용량 기준), 저장용 스냅샷과 나눠 쓰는 조각도 포함
+		size_t listSlackBytes = 0;		// 그중 아직 쓰지 않은 용량
+		size_t indexBytes = 0;			// id 색인, 이름 색인, 정렬 뷰
+		size_t arenaReservedBytes = 0;	// 풀이 받아 둔 바이트, 풀에서 만든 아이템은 bytesByCategory 와 겹칩니다.
+		size_t arenaLiveBytes = 0;
+		size_t nameTableBytes = 0;		// 전역 이름 테이블, 모든 매니저가 함께 씁니다.
+
+		size_t TotalBytes() const
+		{
+			return accumulate(begin(bytesByCategory), end(bytesByCategory), size_t(0)) + listBytes + indexBytes + nameTableBytes;
+		}
+	};
+	MemoryUsage GetMemoryUsage() const
+	{
+		constexpr size_t kControlBlockBytes = sizeof(void*) + 2 * sizeof(int);		// 가상 함수 표 + 참조 수 두 개
+		constexpr size_t kTreeNodeBytes = 3 * sizeof(void*) + sizeof(int) + sizeof(const Item*);
+		constexpr size_t kObjectBytes[kItemCategoryCount] = { sizeof(Item), sizeof(Weapon), sizeof(Armor), sizeof(Ring) };
+		MemoryUsage usage;
+		usage.liveItems = LiveCount();
+		usage.tombstones = compaction.tombstones;
+		for (size_t c = 0; c < kItemCategoryCount; ++c)
+		{
+			usage.itemsByCategory[c] = byCategoryLevel[c].size();
+			usage.bytesByCategory[c] = usage.itemsByCategory[c] * (kObjectBytes[c] + kControlBlockBytes);
+		}
+		ItemListVersion version = atomic_load(&published);
+		usage.listBytes = itemlist.capacity() * sizeof(shared_ptr<Item>) + itemlist.TableBytes() + slotOf.capacity() * sizeof(uint32_t)
+			+ slots.capacity() * sizeof(Slot) + freeSlots.capacity() * sizeof(uint32_t) + version->capacity() * sizeof(shared_ptr<const Item>);
+		usage.listSlackBytes = (itemlist.capacity() - itemlist.size()) * sizeof(shared_ptr<Item>) + (slotOf.capacity() - slotOf.size()) * sizeof(uint32_t)
+			+ (slots.capacity() - slots.size()) * sizeof(Slot) + (freeSlots.capacity() - freeSlots.size()) * sizeof(uint32_t);
+		usage.indexBytes = idIndex.bucket_count() * sizeof(void*) + idIndex.size() * (sizeof(void*) + sizeof(pair<const int, size_t>))
+			+ nameIndex.capacity() * sizeof(unordered_set<int>) + (byName.size() + byLevel.size()) * kTreeNodeBytes
+			+ 2 * usage.liveItems * kTreeNodeBytes;		// 등급별, 종류별 뷰
+		for (auto& ids : nameIndex) usage.indexBytes += ids.bucket_count() * sizeof(void*) + ids.size() * (sizeof(void*) + sizeof(int));
+		usage.arenaReservedBytes = arena->GetStats().reservedBytes;
+		usage.arenaLiveBytes = arena->GetStats().liveBytes;
+		usage.nameTableBytes = ItemNames().MemoryBytes();
+		return usage;
+	}
+	const array<OpCounters, kItemOpCount>& GetOpCounters() const { return opCounters; }
+	// interval 마다 (공개 변경 함수가 끝날 때 확인) exporter 를 부릅니다. 변경하는 스레드에서 불리므로 짧게 끝내야 합니다.
+	void SetStatsExporter(StatsExporter statsExporter, chrono::milliseconds interval)
+	{
+		exporter = move(statsExporter);
+		exportInterval = interval;
+		lastExport = chrono::steady_clock::now();
+	}
+
+	// 현재 발행된 버전을 돌려줍니다. 어느 스레드에서든 잠금 없이 부를 수 있습니다.
+	ItemListVersion ReadVersion() const { return atomic_load(&published); }
+	// 쓰는 쪽 : 지금 목록을 새 버전으로 발행합니다. 바뀐 것이 없으면 아무것도 하지 않습니다.
+	// 변경을 몇 개 모아 발행하면 그 사이의 중간 상태는 읽는 쪽에 보이지 않습니다.
+	void PublishVersion()
+	{
+		OpScope scope(*this, ItemOp::Publish);
+		retired.erase(remove_if(begin(retired), end(retired), [](const ItemListVersion& v) { return v.use_count() == 1; }), end(retired));
+		if (changes == publishedChanges) return;
+		publishedChanges = changes;
+		auto next = make_shared<vector<shared_ptr<const Item>>>();
+		next->reserve(LiveCount());
+		copy_if(begin(itemlist), end(itemlist), back_inserter(*next), [](const shared_ptr<Item>& item) { return item != nullptr; });
+		retired.push_back(atomic_exchange(&published, ItemListVersion(move(next))));
+	}
+	// 아직 읽는 쪽이 들고 있는 지난 버전 수
+	size_t RetiredVersions() const { return retired.size(); }
+	// 모든 아이템을 비우고 새 풀로 바꿉니다. 밖에서 들고 있는 아이템이 없으면 이전 풀의 메모리가 한 번에 해제됩니다.
+	void Clear()
+	{
+		OpScope scope(*this, ItemOp::Remove);
+		Reset();
+		if (journal) Journaled(journal->LogClear());
+	}
+
+	void Reserve(size_t count)
+	{
+		itemlist.reserve(count);
+		idIndex.reserve(count);
+		slotOf.reserve(count);
+	}
+
+	// 아이템 목록을 바이너리 스냅샷 파일로 저장합니다.
+	//	저널이 연결되어 있으면 먼저 새 구획을 열고 그 번호를 스냅샷에 적으므로, 이 스냅샷으로 Recover 하면 저널에서 그 뒤의 기록만 다시 적용합니다.
+	//	구획 표시를 디스크에 내리지 못하면 저장하지 않고 false.
+	bool SaveSnapshot(const string& path)
+	{
+		uint32_t epoch = 0;
+		return StartJournalEpoch(epoch) && WriteSnapshot(itemlist, LiveCount(), path, epoch);
+	}
+
+	// 지금 목록을 얼립니다. 조각 표만 나눠 가지므로 아이템 수와 무관하게 O(1) 이고,
+	//	그 뒤 이 매니저에서 일어나는 변경은 건드린 조각만 복사하므로 스냅샷에는 보이지 않습니다.
+	//	스냅샷은 어느 스레드에서 읽어도 되고, 놓은 스냅샷의 메모리는 다음 공개 함수가 끝날 때 이 매니저의 스레드에서 해제합니다.
+	//	(아이템 객체는 복사하지 않으므로 추가한 뒤에 아이템 내용을 직접 바꾸지 않는다고 가정합니다. ReadVersion 과 같은 전제)
+	ItemListSnapshot TakeSnapshot()
+	{
+		OpScope scope(*this, ItemOp::Snapshot);
+		frozen.push_back(make_shared<const ChunkedItemList>(itemlist));
+		return frozen.back();
+	}
+	// 스냅샷을 뜨고 저장은 다른 스레드에서 합니다. 이 스레드가 멈추는 시간은 TakeSnapshot 과 스레드 시작뿐입니다.
+	//	Checkpoint 처럼 임시 파일에 쓰고 디스크까지 내린 뒤 교체하므로, 저장 중에 멈춰도 path 의 이전 스냅샷은 남습니다.
+	//	SaveSnapshot 처럼 저널 구획도 스냅샷에 적습니다. 앞선 저장이 아직 WaitBackgroundSave 로 끝나지 않았거나 구획 표시를 못 남기면 시작하지 않고 false.
+	bool SaveSnapshotInBackground(const string& path)
+	{
+		uint32_t epoch = 0;
+		if (saving.valid() || !StartJournalEpoch(epoch)) return false;
+		savingSnapshot = TakeSnapshot();
+		saving = async(launch::async, [snapshot = savingSnapshot.get(), live = LiveCount(), path, epoch] {
+			return ReplaceSnapshot(*snapshot, live, path, epoch);
+		});
+		return true;
+	}
+	bool IsSavingInBackground() const { return saving.valid() && saving.wait_for(chrono::seconds(0)) != future_status::ready; }
+	// 백그라운드 저장이 끝날 때까지 기다려 결과를 돌려줍니다. 진행 중인 저장이 없으면 false.
+	bool WaitBackgroundSave()
+	{
+		if (!saving.valid()) return false;
+		bool saved = saving.get();
+		savingSnapshot.reset();
+		ReleaseSnapshots();
+		return saved;
+	}
+	size_t LiveSnapshots() const { return frozen.size(); }
+
+	// 임시 파일에 쓰고 디스크까지 내린 뒤 이름을 바꿔 교체합니다. 중간에 멈춰도 path 의 이전 스냅샷은 그대로입니다.
+	static bool ReplaceSnapshot(const ChunkedItemList& items, size_t liveCount, const string& path, uint32_t journalEpoch = 0)
+	{
+		string temporary = path + ".tmp";
+		if (WriteSnapshot(items, liveCount, temporary, journalEpoch) && SyncFile(temporary) && ReplaceFileDurably(temporary, path)) return true;
+		error_code error;
+		filesystem::remove(temporary, error);
+		return false;
+	}
+	static bool WriteSnapshot(const ChunkedItemList& items, size_t liveCount, const string& path, uint32_t journalEpoch = 0)
+	{
+		ofstream file(path, ios::binary | ios::trunc);
+		if (!file) return false;
+
+		// 이 목록에 쓰인 이름만 스냅샷 이름 목록에 담습니다.
+		unordered_map<uint32_t, uint32_t> nameOf;		// 이름 심볼 -> 스냅샷 이름 번호
+		vector<SnapshotName> snapshotNames;
+		string nameBytes;
+		for (auto& item : items)
+		{
+			if (!item) continue;
+			auto added = nameOf.emplace(item->name.Symbol(), static_cast<uint32_t>(snapshotNames.size()));
+			if (!added.second) continue;
+			const string& name = item->name.str();
+			snapshotNames.push_back({ static_cast<uint32_t>(nameBytes.size()), static_cast<uint32_t>(name.size()) });
+			nameBytes += name;
+		}
+
+		SnapshotHeader header = { { 'I', 'T', 'E', 'M' }, kSnapshotVersion, liveCount,
+			static_cast<uint32_t>(snapshotNames.size()), journalEpoch, nameBytes.size() };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(snapshotNames.data()), snapshotNames.size() * sizeof(SnapshotName));
+		file.write(nameBytes.data(), nameBytes.size());
+		file.write("\0\0\0\0\0\0\0", SnapshotPadding(nameBytes.size()));		// 레코드를 정렬된 위치에서 시작
+
+		// 레코드는 블록 단위로 모아서 씁니다.
+		vector<SnapshotRecord> block;
+		block.reserve(min<size_t>(liveCount, 64 * 1024));
+		for (auto& item : items)
+		{
+			if (!item) continue;
+			SnapshotRecord record = { item->id, item->level, StatOf(*item), nameOf[item->name.Symbol()], static_cast<uint8_t>(item->category), item->grade, 0 };
+			block.push_back(record);
+			if (block.size() == block.capacity())
+			{
+				file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(SnapshotRecord));
+				block.clear();
+			}
+		}
+		file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(SnapshotRecord));
+		file.close();
+		return !file.fail();
+	}
+	// 스냅샷 파일을 메모리 맵으로 열어 목록을 새로 만듭니다. 형식이 맞지 않으면 false 이고 목록은 그대로입니다.
+	//	journalEpoch 에는 스냅샷에 적힌 저널 구획을 담습니다. (ReplayJournal 의 fromEpoch)
+	bool LoadSnapshot(const string& path, uint32_t* journalEpoch = nullptr)
+	{
+		OpScope scope(*this, ItemOp::Load);
+		MappedFile file(path);
+		if (!file.Data() || file.Size() < sizeof(SnapshotHeader)) return false;
+
+		SnapshotHeader header;
+		memcpy(&header, file.Data(), sizeof(header));
+		if (memcmp(header.magic, "ITEM", 4) != 0 || header.version == 0 || header.version > kSnapshotVersion) return false;
+		if (header.nameCount > file.Size() || header.nameBytes > file.Size()) return false;
+		size_t namesAt = sizeof(SnapshotHeader);
+		size_t bytesAt = namesAt + header.nameCount * sizeof(SnapshotName);
+		size_t recordsAt = bytesAt + header.nameBytes + SnapshotPadding(header.nameBytes);
+		if (recordsAt > file.Size() || (file.Size() - recordsAt) / sizeof(SnapshotRecord) < header.itemCount) return false;
+
+		// 이름은 종류별로 한 번만 등록합니다.
+		const SnapshotName* snapshotNames = reinterpret_cast<const SnapshotName*>(file.Data() + namesAt);
+		const char* nameBytes = reinterpret_cast<const char*>(file.Data() + bytesAt);
+		vector<ItemName> loadedNames;
+		loadedNames.reserve(header.nameCount);
+		for (uint32_t i = 0; i < header.nameCount; ++i)
+		{
+			if (uint64_t(snapshotNames[i].offset) + snapshotNames[i].length > header.nameBytes) return false;
+			loadedNames.emplace_back(string(nameBytes + snapshotNames[i].offset, snapshotNames[i].length));
+		}
+
+		// 목록을 비우기 전에 모든 레코드를 검사합니다.
+		const SnapshotRecord* records = reinterpret_cast<const SnapshotRecord*>(file.Data() + recordsAt);
+		for (uint64_t i = 0; i < header.itemCount; ++i)
+			if (records[i].name >= loadedNames.size() || records[i].category >= kItemCategoryCount) return false;
+
+		Reset();
+		Reserve(header.itemCount);
+		vector<shared_ptr<Item>> loaded;
+		loaded.reserve(header.itemCount);
+		for (uint64_t i = 0; i < header.itemCount; ++i)
+		{
+			const SnapshotRecord& record = records[i];
+			loaded.push_back(MakeItemOf(static_cast<ItemCategory>(record.category), record.id, loadedNames[record.name], record.level, record.grade, record.stat));
+		}
+		InsertAll(loaded);
+		if (journalEpoch) *journalEpoch = header.journalEpoch;
+		return true;
+	}
+
+	// 저널 연결 : 이후 AddItem, RemoveItemById, RemoveItemByName, MergeItems, Commit, Clear 가 기록됩니다.
+	void AttachJournal(ItemJournal* target) { journal = target; }
+	// 변경 함수가 남긴 기록 중 그룹 커밋(write, fsync)에 실패한 것이 있었으면 true. 변경 자체는 메모리에 반영되어 있고,
+	//	쓰지 못한 레코드는 저널 버퍼에 남아 다음 Flush 에서 다시 씁니다. 확인한 뒤 ClearJournalError 로 지웁니다.
+	bool HasJournalError() const { return journalFailed; }
+	void ClearJournalError() { journalFailed = false; }
+	// 저널 파일의 기록을 현재 목록 위에 다시 적용합니다. 적용한 레코드 수를 돌려줍니다.
+	//	구획 fromEpoch 의 표시보다 앞의 레코드는 이미 스냅샷에 들어 있으므로 건너뜁니다. (0 이면 모두 적용)
+	//	validBytes 에는 마지막으로 온전한 레코드가 끝나는 위치를 담습니다. (그 뒤는 잘렸거나 깨진 꼬리)
+	size_t ReplayJournal(const string& path, uint64_t* validBytes = nullptr, uint32_t fromEpoch = 0)
+	{
+		OpScope scope(*this, ItemOp::Load);
+		ItemJournal* attached = journal;
+		journal = nullptr;			// 다시 적용하는 변경은 기록하지 않습니다.
+		uint32_t epoch = 0;
+		size_t applied = 0;
+		uint64_t valid = ItemJournal::ForEachRecord(path, [&](const char* body, size_t length) {
+			if (static_cast<ItemJournal::Op>(body[0]) == ItemJournal::Op::Epoch)
+			{
+				if (length < 1 + sizeof(uint32_t)) return false;
+				memcpy(&epoch, body + 1, sizeof(epoch));
+				return true;
+			}
+			if (epoch < fromEpoch) return true;
+			if (!ApplyJournalRecord(body, length)) return false;
+			++applied;
+			return true;
+		});
+		journal = attached;
+		if (validBytes) *validBytes = valid;
+		return applied;
+	}
+	// 스냅샷을 새로 저장하고 저널을 비웁니다. 스냅샷이 디스크에 내려간 뒤에만 저널을 비웁니다.
+	//	그 사이에 멈춰도 스냅샷에 적힌 구획 덕분에 Recover 는 남은 저널을 두 번 적용하지 않습니다.
+	bool Checkpoint(const string& snapshotPath)
+	{
+		uint32_t epoch = 0;
+		if (!StartJournalEpoch(epoch)) return false;
+		if (!ReplaceSnapshot(itemlist, LiveCount(), snapshotPath, epoch)) return false;
+		return !journal || journal->Truncate();
+	}
+	// 시작할 때 : 마지막 스냅샷(없으면 빈 목록)을 읽고 저널에서 스냅샷 뒤의 기록만 다시 적용합니다.
+	bool Recover(const string& snapshotPath, const string& journalPath)
+	{
+		OpScope scope(*this, ItemOp::Load);
+		uint32_t epoch = 0;
+		if (filesystem::exists(snapshotPath)) { if (!LoadSnapshot(snapshotPath, &epoch)) return false; }
+		else Reset();
+		// 깨진 꼬리를 남겨 두면 이후 덧붙이는 레코드가 그 뒤에 쌓여 다음 복구 때 읽히지 않으므로 잘라냅니다.
+		uint64_t validBytes = 0;
+		ReplayJournal(journalPath, &validBytes, epoch);
+		error_code error;
+		uint64_t journalBytes = filesystem::file_size(journalPath, error);
+		return error || journalBytes == validBytes || TruncateFile(journalPath, validBytes);
+	}
+
+	// 추가한 아이템의 핸들을 돌려줍니다. 같은 id 가 이미 있으면 추가하지 않고 kInvalidHandle.
+	ItemHandle AddItem(const shared_ptr<Item>& item)
+	{
+		OpScope scope(*this, ItemOp::Add);
+		ItemHandle handle = Insert(item);
+		if (journal && handle != kInvalidHandle) LogAdd(*item);
+		return handle;
+	}
+	// 돌려주는 아이템은 읽기 전용입니다. 이름, 레벨, 등급을 바꾸면 정렬 뷰가 깨지므로 지우고 새로 추가합니다.
+	shared_ptr<const Item> FindItemById(int id) const
+	{
+		auto found = idIndex.find(id);
+		return found != end(idIndex) ? itemlist[found->second] : nullptr;
+	}
+	// 핸들로 찾기 : 슬롯 번호로 바로 찾고 세대만 비교합니다. 지워진 아이템의 핸들이면 nullptr.
+	const Item* GetItem(ItemHandle handle) const
+	{
+		size_t position = PositionOf(handle);
+		return position != SIZE_MAX ? itemlist[position].get() : nullptr;
+	}
+	ItemHandle HandleOf(int id) const
+	{
+		auto found = idIndex.find(id);
+		if (found == end(idIndex)) return kInvalidHandle;
+		uint32_t slot = slotOf[found->second];
+		return (static_cast<uint64_t>(slots[slot].generation) << 32) | slot;
+	}
+	void RemoveItem(ItemHandle handle)
+	{
+		OpScope scope(*this, ItemOp::Remove);
+		size_t position = PositionOf(handle);
+		if (position == SIZE_MAX) return;
+		if (journal) Journaled(journal->LogRemoveById(itemlist[position]->id));
+		EraseAt({ position });
+	}
+	void RemoveItemByName(const string& name)
+	{
+		OpScope scope(*this, ItemOp::Remove);
+		// 이름 색인으로 지울 아이템만 골라내므로, 다른 아이템의 이름은 비교하지 않습니다.
+		uint32_t symbol = ItemNames().Find(name);
+		if (symbol == NameTable::npos || symbol >= nameIndex.size() || nameIndex[symbol].empty()) return;
+		vector<size_t> positions;
+		positions.reserve(nameIndex[symbol].size());
+		for (int id : nameIndex[symbol]) positions.push_back(idIndex[id]);
+		sort(begin(positions), end(positions));
+		EraseAt(positions);
+		if (journal) Journaled(journal->LogRemoveByName(name));
+	}
+	void RemoveItemById(int id)
+	{
+		OpScope scope(*this, ItemOp::Remove);
+		auto found = idIndex.find(id);
+		if (found == end(idIndex)) return;
+		EraseAt({ found->second });
+		if (journal) Journaled(journal->LogRemoveById(id));
+	}
+	void MergeItems(int id1, int id2, int newId)
+	{
+		OpScope scope(*this, ItemOp::Merge);
+		auto found1 = idIndex.find(id1);
+		auto found2 = idIndex.find(id2);
+		if (id1 == id2 || found1 == end(idIndex) || found2 == end(idIndex)) return;
+		if (newId != id1 && newId != id2 && idIndex.count(newId)) return;
+
+		auto item1 = itemlist[found1->second];
+		auto item2 = itemlist[found2->second];
+		if (item1->grade == item2->grade)
+		{
+			char newGrade = UpgradeGrade(item1->grade);
+			auto newItem = MakeItem<Item>(newId, item1->name, 1, newGrade);
+			cout << newId << ' ' << item1->name << ' ' << 1 << ' ' << newGrade << ' ' << endl;
+			// 재료 두 개는 한 번의 압축으로 지우고, 결과는 맨 뒤에 붙입니다.
+			EraseAt({ min(found1->second, found2->second), max(found1->second, found2->second) });
+			Insert(newItem);
+			if (journal) Journaled(journal->LogMerge({ id1, id2, newId }));
+		}
+	}
+	// 여러 합성을 한 번에 처리합니다. 각 요청은 앞의 요청이 끝난 상태를 기준으로 MergeItems 와 같은 규칙으로 검사하며,
+	// 앞에서 만들어진 아이템을 뒤 요청의 재료로 쓸 수도 있습니다.
+	// 재료 삭제는 마지막에 한 번의 압축으로, 결과 아이템은 요청 순서대로 뒤에 붙입니다. 성공한 합성 수를 돌려줍니다.
+	size_t MergeItems(const vector<MergeRequest>& requests)
+	{
+		OpScope scope(*this, ItemOp::Merge);
+		vector<size_t> consumed;						// 지울 기존 아이템 위치
+		unordered_set<int> consumedIds;
+		vector<shared_ptr<Item>> created;				// 이번 배치에서 만든 아이템, 재료로 쓰이면 nullptr
+		unordered_map<int, size_t> createdIndex;		// id -> created 위치
+
+		auto lookup = [&](int id) -> shared_ptr<Item> {
+			auto made = createdIndex.find(id);
+			if (made != end(createdIndex)) return created[made->second];
+			auto found = idIndex.find(id);
+			if (found == end(idIndex) || consumedIds.count(id)) return nullptr;
+			return itemlist[found->second];
+		};
+		auto consume = [&](int id) {
+			auto made = createdIndex.find(id);
+			if (made != end(createdIndex)) { created[made->second] = nullptr; createdIndex.erase(made); return; }
+			consumedIds.insert(id);
+			consumed.push_back(idIndex[id]);
+		};
+
+		size_t merged = 0;
+		for (const MergeRequest& request : requests)
+		{
+			if (request.id1 == request.id2) continue;
+			auto item1 = lookup(request.id1);
+			auto item2 = lookup(request.id2);
+			if (!item1 || !item2 || item1->grade != item2->grade) continue;
+			if (request.newId != request.id1 && request.newId != request.id2 && lookup(request.newId)) continue;
+
+			auto newItem = MakeItem<Item>(request.newId, item1->name, 1, UpgradeGrade(item1->grade));
+			consume(request.id1);
+			consume(request.id2);
+			createdIndex[request.newId] = created.size();
+			created.push_back(newItem);
+			if (journal) Journaled(journal->LogMerge(request));		// 배치 결과는 성공한 합성을 차례로 한 것과 같습니다.
+			++merged;
+		}
+
+		sort(begin(consumed), end(consumed));
+		EraseAt(consumed);
+		itemlist.reserve(itemlist.size() + created.size());
+		for (auto& item : created) if (item) Insert(item);
+		return merged;
+	}
+	// 트랜잭션 적용 : 단계마다 앞 단계까지 적용한 상태를 기준으로 공개 함수와 같은 규칙으로 검사합니다.
+	//	(이미 있는 id 추가, 합성 규칙에 맞지 않는 합성은 실패, 없는 id 삭제는 아무 일 없음)
+	//	하나라도 실패하면 아무것도 바꾸지 않고 false 를 돌려주며 트랜잭션은 그대로 남습니다. 실패한 단계 번호는 failedStep 에.
+	//	모두 통과하면 지울 기존 아이템은 한 번의 압축으로 지우고, 새 아이템은 단계 순서대로 뒤에 붙인 뒤 트랜잭션을 비웁니다.
+	//	결과는 각 단계를 공개 함수로 차례로 부른 것과 같습니다. (합성 결과 출력은 하지 않습니다)
+	//	반영에 필요한 메모리는 매니저를 바꾸기 전에 모두 잡으므로, bad_alloc 이 나가도 매니저와 트랜잭션은 그대로입니다.
+	bool Commit(ItemTransaction& transaction, size_t* failedStep = nullptr)
+	{
+		OpScope scope(*this, ItemOp::Commit);
+		using Op = ItemTransaction::Op;
+		vector<size_t> consumed;						// 지울 기존 아이템 위치
+		unordered_set<int> consumedIds;
+		vector<shared_ptr<Item>> created;				// 이번 트랜잭션에서 만든 아이템, 지워지면 nullptr
+		unordered_map<int, size_t> createdIndex;		// id -> created 위치
+
+		auto lookup = [&](int id) -> const Item* {
+			auto made = createdIndex.find(id);
+			if (made != end(createdIndex)) return created[made->second].get();
+			auto found = idIndex.find(id);
+			if (found == end(idIndex) || consumedIds.count(id)) return nullptr;
+			return itemlist[found->second].get();
+		};
+		auto consume = [&](int id) {
+			auto made = createdIndex.find(id);
+			if (made != end(createdIndex)) { created[made->second] = nullptr; createdIndex.erase(made); return; }
+			if (!idIndex.count(id) || !consumedIds.insert(id).second) return;
+			consumed.push_back(idIndex[id]);
+		};
+		auto create = [&](shared_ptr<Item> item) {
+			createdIndex[item->id] = created.size();
+			created.push_back(move(item));
+		};
+
+		const vector<ItemTransaction::Step>& steps = transaction.Steps();
+		for (size_t i = 0; i < steps.size(); ++i)
+		{
+			const ItemTransaction::Step& step = steps[i];
+			bool ok = true;
+			switch (step.op)
+			{
+			case Op::Add:
+				ok = step.item && !lookup(step.item->id);
+				if (ok) create(step.item);
+				break;
+			case Op::RemoveById:
+				if (lookup(step.request.id1)) consume(step.request.id1);
+				break;
+			case Op::RemoveByName:
+			{
+				uint32_t symbol = ItemNames().Find(step.name);
+				if (symbol == NameTable::npos) break;
+				if (symbol < nameIndex.size())
+					for (int id : nameIndex[symbol]) if (!consumedIds.count(id)) consume(id);
+				for (auto& item : created) if (item && item->name.Symbol() == symbol) consume(item->id);
+				break;
+			}
+			case Op::Merge:
+			{
+				const MergeRequest& request = step.request;
+				const Item* item1 = lookup(request.id1);
+				const Item* item2 = lookup(request.id2);
+				ok = request.id1 != request.id2 && item1 && item2 && item1->grade == item2->grade
+					&& (request.newId == request.id1 || request.newId == request.id2 || !lookup(request.newId));
+				if (!ok) break;
+				auto newItem = MakeItem<Item>(request.newId, item1->name, 1, UpgradeGrade(item1->grade));
+				consume(request.id1);
+				consume(request.id2);
+				create(newItem);
+				break;
+			}
+			}
+			if (!ok)
+			{
+				if (failedStep) *failedStep = i;
+				return false;
+			}
+		}
+
+		// 여기부터는 검사를 모두 통과한 변경만 반영합니다.
+		//	목록 조각, 슬롯 자리, 해시 버킷, 색인 노드와 저널 레코드를 먼저 모두 만들고, 반영하는 동안은 할당하지 않습니다.
+		vector<shared_ptr<Item>> added;
+		added.reserve(created.size());
+		for (auto& item : created) if (item) added.push_back(item);
+		sort(begin(consumed), end(consumed));
+		size_t listSize = itemlist.size() + added.size();
+		bool compact = !consumed.empty() && compaction.tombstones + consumed.size() > maxDeadRatio * listSize;
+		if (!consumed.empty()) PrepareErase(consumed, compact, listSize);
+		itemlist.ReserveChunks(listSize);
+		ReserveMore(slots, added.size());
+		ReserveMore(slotOf, added.size());
+		ReserveMore(idIndex, added.size());
+		StagedNodes nodes = StageNodes(added);
+		if (journal) Journaled(journal->LogCommit(steps));		// 다시 적용할 때도 전부이거나 아무것도 아니도록 레코드 하나로
+
+		if (!consumed.empty()) Unlink(consumed);
+		for (size_t i = 0; i < added.size(); ++i) InsertStaged(added[i], nodes, i);
+		if (compact) Compact();
+		transaction.Discard();
+		return true;
+	}
+	// 자동 합성 : 같은 등급(sameNameOnly 면 같은 등급 + 같은 이름)끼리 목록 순서대로 두 개씩 짝지어 합성하고,
+	// 결과 아이템은 다시 한 단계 위 등급의 후보가 되어 S 등급이 될 때까지 반복합니다.
+	// 등급별로 나누는 데 O(n), 짝짓기도 후보마다 한 번씩이라 전체가 선형 시간입니다.
+	// 새 아이템 id 는 firstNewId 부터 차례로 붙이며, 실제로 수행한 합성 목록을 돌려줍니다.
+	vector<MergeRequest> AutoMerge(int firstNewId, bool sameNameOnly = false)
+	{
+		OpScope scope(*this, ItemOp::Merge);
+		map<char, map<uint32_t, vector<int>>, greater<char>> buckets;	// 낮은 등급(큰 문자)부터
+		for (auto& item : itemlist)
+		{
+			if (!item || item->grade == 'S') continue;
+			uint32_t key = sameNameOnly ? item->name.Symbol() : 0;
+			buckets[item->grade][key].push_back(item->id);
+		}
+
+		vector<MergeRequest> plan;
+		int nextId = firstNewId;
+		for (auto& grade : buckets)		// 처리 중 위 등급 버킷이 새로 생겨도 뒤에서 방문됩니다.
+		{
+			char upgraded = UpgradeGrade(grade.first);
+			for (auto& bucket : grade.second)
+			{
+				vector<int>& ids = bucket.second;
+				for (size_t i = 0; i + 1 < ids.size(); i += 2)
+				{
+					while (idIndex.count(nextId)) ++nextId;
+					plan.push_back({ ids[i], ids[i + 1], nextId });
+					if (upgraded != 'S') buckets[upgraded][bucket.first].push_back(nextId);
+					++nextId;
+				}
+			}
+		}
+		MergeItems(plan);
+		return plan;
+	}
+	// 목록 순서대로 writer 에 씁니다. (cout, 파일, 메모리 / Text, Csv, Tsv)
+	void WriteItems(ItemWriter& writer) const
+	{
+		for (auto& item : itemlist) if (item) writer.Write(*item);
+		writer.Flush();
+	}
+	void PrintItems()
+	{
+		if (LiveCount() >= parallelThreshold)
+		{
+			Compact();
+			PrintItemsParallel(itemlist, [](auto& a) -> const Item& { return *a; });
+			return;
+		}
+		ItemWriter writer(cout);
+		WriteItems(writer);
+		cout << endl;
+	}
+	// 정렬 뷰 : 목록 순서를 바꾸지 않고 정렬된 순서로 읽습니다. 읽을 때 추가 정렬 비용이 없습니다.
+	const set<const Item*, ItemByName>& ItemsByName() const { return byName; }
+	const set<const Item*, ItemByLevel>& ItemsByLevel() const { return byLevel; }
+
+	// 레벨이 minLevel 이상 maxLevel 이하인 아이템, 레벨 순. 목록 순서는 바꾸지 않고 O(log n + k) 입니다.
+	vector<const Item*> ItemsInLevelRange(int minLevel, int maxLevel) const { return LevelRange(byLevel, minLevel, maxLevel); }
+	vector<const Item*> ItemsInLevelRange(int minLevel, int maxLevel, char grade) const
+	{
+		auto view = byGradeLevel.find(grade);
+		return view != end(byGradeLevel) ? LevelRange(view->second, minLevel, maxLevel) : vector<const Item*>();
+	}
+	// 레벨이 높은 아이템 k 개, 높은 순. (같은 레벨은 ItemsByLevel 의 역순) O(log n + k) 입니다.
+	vector<const Item*> TopByLevel(size_t k) const { return Top(byLevel, k); }
+	vector<const Item*> TopByLevel(size_t k, char grade) const
+	{
+		auto view = byGradeLevel.find(grade);
+		return view != end(byGradeLevel) ? Top(view->second, k) : vector<const Item*>();
+	}
+
+	// 종류별 뷰 (레벨 순) : ItemCategory::Item 뷰에는 파생 클래스가 아닌 아이템만 있습니다.
+	const set<const Item*, ItemByLevel>& ItemsOfCategory(ItemCategory category) const { return byCategoryLevel[static_cast<size_t>(category)]; }
+	// 종류별 순회 : ForEachOf<Weapon>([](const Weapon& w) { ... }), 목록 순.
+	//	연속된 목록을 훑으며 종류 태그만 비교하므로 dynamic_cast, shared_ptr 복사가 없고, 트리 뷰를 따라가는 것보다 빠릅니다.
+	template<typename T, typename Visit>
+	void ForEachOf(Visit visit) const
+	{
+		for (auto& item : itemlist) if (item && item->category == T::kCategory) visit(static_cast<const T&>(*item));
+	}
+
+	// 조회 : 조건에 맞는 아이템을 차례로 visit(const Item&) 에 넘기고 그 수를 돌려줍니다.
+	//	후보는 추정 후보 수가 가장 적은 색인에서 고릅니다. (이름 색인, 등급별, 종류별 레벨 뷰, 레벨 뷰, 없으면 정렬에 맞는 뷰나 목록)
+	//	나머지 조건은 후보를 한 번 훑으면서 함께 검사하고, 후보의 순서가 요청한 정렬과 같으면 limit 개에서 바로 멈춥니다.
+	//	정렬이 다르면 조건에 맞는 아이템만 모아 limit 개까지 부분 정렬합니다. 정렬을 정하지 않으면 순서는 고른 색인을 따릅니다.
+	template<typename Visit>
+	size_t Query(const ItemQuery& query, Visit visit) const
+	{
+		using Order = ItemQuery::Order;
+		if (query.maxCount == 0) return 0;
+		uint32_t nameSymbol = NameTable::npos;
+		if (query.name)
+		{
+			nameSymbol = ItemNames().Find(*query.name);
+			if (nameSymbol == NameTable::npos || nameSymbol >= nameIndex.size()) return 0;
+		}
+		const set<const Item*, ItemByLevel>* gradeView = nullptr;
+		if (query.grade)
+		{
+			auto found = byGradeLevel.find(*query.grade);
+			if (found == end(byGradeLevel)) return 0;
+			gradeView = &found->second;
+		}
+
+		// 후보 수 추정 : 이름 색인은 후보마다 id 해시 조회가 있어 두 배로 치고,
+		// 레벨 뷰는 뷰의 최소~최대 레벨 중 조회 구간이 차지하는 비율만큼으로 봅니다. (레벨이 고르게 퍼져 있다고 가정)
+		enum class Source { Name, GradeLevel, CategoryLevel, Level, ByName, List } source = Source::List;
+		double estimate = static_cast<double>(LiveCount());
+		auto levelEstimate = [&](const set<const Item*, ItemByLevel>& view) {
+			if (view.empty()) return 0.0;
+			double low = max<double>(query.minLevel, (*view.begin())->level), high = min<double>(query.maxLevel, (*view.rbegin())->level);
+			if (low > high) return 0.0;
+			return view.size() * (high - low + 1) / ((*view.rbegin())->level - (*view.begin())->level + 1.0);
+		};
+		if (query.name && 2.0 * nameIndex[nameSymbol].size() < estimate) { source = Source::Name; estimate = 2.0 * nameIndex[nameSymbol].size(); }
+		if (gradeView && levelEstimate(*gradeView) < estimate) { source = Source::GradeLevel; estimate = levelEstimate(*gradeView); }
+		const set<const Item*, ItemByLevel>* categoryView = query.category ? &ItemsOfCategory(*query.category) : nullptr;
+		if (categoryView && levelEstimate(*categoryView) < estimate) { source = Source::CategoryLevel; estimate = levelEstimate(*categoryView); }
+		if (query.HasLevelRange() && levelEstimate(byLevel) < estimate) { source = Source::Level; estimate = levelEstimate(byLevel); }
+		if (source == Source::List)
+		{
+			if (query.order == Order::Level || query.order == Order::LevelDescending) source = Source::Level;
+			else if (query.order == Order::Name) source = Source::ByName;
+		}
+		bool levelSource = source == Source::GradeLevel || source == Source::CategoryLevel || source == Source::Level;
+		bool ordered = query.order == Order::None
+			|| (levelSource && (query.order == Order::Level || query.order == Order::LevelDescending))
+			|| (source == Source::ByName && query.order == Order::Name);
+
+		size_t count = 0;
+		vector<const Item*> matched;			// 정렬을 다시 해야 할 때만 씁니다.
+		auto accept = [&](const Item* item) {
+			if (!Matches(query, *item, nameSymbol)) return true;
+			if (!ordered) { matched.push_back(item); return true; }
+			visit(*item);
+			return ++count < query.maxCount;
+		};
+		bool descending = query.order == Order::LevelDescending;
+		switch (source)
+		{
+		case Source::Name:
+			for (int id : nameIndex[nameSymbol]) if (!accept(itemlist[idIndex.at(id)].get())) break;
+			break;
+		case Source::GradeLevel: ScanLevels(*gradeView, query.minLevel, query.maxLevel, descending, accept); break;
+		case Source::CategoryLevel: ScanLevels(*categoryView, query.minLevel, query.maxLevel, descending, accept); break;
+		case Source::Level: ScanLevels(byLevel, query.minLevel, query.maxLevel, descending, accept); break;
+		case Source::ByName: for (const Item* item : byName) if (!accept(item)) break; break;
+		case Source::List: for (auto& item : itemlist) if (item && !accept(item.get())) break; break;
+		}
+		if (ordered) return count;
+
+		auto middle = begin(matched) + min(query.maxCount, matched.size());
+		if (query.order == Order::Name) partial_sort(begin(matched), middle, end(matched), ItemByName());
+		else if (query.order == Order::Level) partial_sort(begin(matched), middle, end(matched), ItemByLevel());
+		else partial_sort(begin(matched), middle, end(matched), [](const Item* a, const Item* b) { return ItemByLevel()(b, a); });
+		for (auto it = begin(matched); it != middle; ++it) visit(**it);
+		return middle - begin(matched);
+	}
+	vector<const Item*> Select(const ItemQuery& query) const
+	{
+		vector<const Item*> items;
+		Query(query, [&](const Item& item) { items.push_back(&item); });
+		return items;
+	}
+	void PrintItemsByName() const
+	{
+		ItemWriter writer(cout);
+		for (const Item* item : byName) writer.Write(*item);
+		writer.Flush();
+		cout << endl;
+	}
+	void PrintItemsByLevel() const
+	{
+		ItemWriter writer(cout);
+		for (const Item* item : byLevel) writer.Write(*item);
+		writer.Flush();
+		cout << endl;
+	}
+	// 목록 자체를 정렬 : 이미 정렬된 뷰를 그대로 옮겨 담습니다.
+	void SortByName()
+	{
+		OpScope scope(*this, ItemOp::Sort);
+		ArrangeBy(byName);
+	}
+	void SortByLevel()
+	{
+		OpScope scope(*this, ItemOp::Sort);
+		ArrangeBy(byLevel);		// 레벨이 같으면 이름, id 순
+	}
+
+private:
+	// 아무도 들고 있지 않은 스냅샷을 놓습니다. 지워진 아이템은 여기서 풀로 돌아갑니다.
+	void ReleaseSnapshots()
+	{
+		frozen.erase(remove_if(begin(frozen), end(frozen), [](const ItemListSnapshot& snapshot) { return snapshot.use_count() == 1; }), end(frozen));
+	}
+
+	// 백그라운드 저장 : 소멸할 때 저장 스레드부터 기다리도록 맨 마지막 멤버로 둡니다.
+	ItemListSnapshot savingSnapshot;
+	future<bool> saving;
+};
+
+// shared_ptr 대신 값으로 담는 ItemManager
+//	아이템마다 힙 할당과 컨트롤 블록을 두지 않고 variant 로 한 배열에 연속해서 저장합니다.
+//	정렬, 출력, 검색은 포인터를 따라가지 않고 연속된 메모리를 순서대로 읽습니다.
+using ItemValue = variant<Item, Weapon, Armor, Ring>;
+
+inline const Item& AsItem(const ItemValue& value) { return visit([](const Item& item) -> const Item& { return item; }, value); }
+inline Item& AsItem(ItemValue& value) { return visit([](Item& item) -> Item& { return item; }, value); }
+
+class FlatItemManager
+{
+	vector<ItemValue> itemlist;
+	unordered_map<int, size_t> idIndex;		// id -> itemlist 위치
+	size_t parallelThreshold = kNoParallel;
+
+	bool UseParallel() const { return itemlist.size() >= parallelThreshold; }
+
+	// from 이후 구간을 한 번 당겨오면서 pred(row) 가 참인 아이템을 지우고 위치를 다시 색인합니다.
+	template<typename Pred>
+	void EraseIf(size_t from, Pred pred)
+	{
+		size_t out = from;
+		for (size_t i = from; i < itemlist.size(); ++i)
+		{
+			const Item& item = AsItem(itemlist[i]);
+			if (pred(i)) { idIndex.erase(item.id); continue; }
+			if (out != i) itemlist[out] = move(itemlist[i]);
+			idIndex[AsItem(itemlist[out]).id] = out;
+			++out;
+		}
+		itemlist.erase(begin(itemlist) + out, end(itemlist));
+	}
+	template<typename Less>
+	void SortBy(Less less)
+	{
+		auto cmp = [&](auto& a, auto& b) { return less(AsItem(a), AsItem(b)); };
+		if (UseParallel()) std::sort(execution::par, begin(itemlist), end(itemlist), cmp);
+		else std::sort(begin(itemlist), end(itemlist), cmp);
+		for (size_t i = 0; i < itemlist.size(); ++i) idIndex[AsItem(itemlist[i]).id] = i;
+	}
+
+public:
+	void Reserve(size_t count) { itemlist.reserve(count); idIndex.reserve(count); }
+	size_t Size() const { return itemlist.size(); }
+	const vector<ItemValue>& Items() const { return itemlist; }
+	void SetParallelThreshold(size_t count) { parallelThreshold = count; }
+
+	bool AddItem(ItemValue item)
+	{
+		if (!idIndex.emplace(AsItem(item).id, itemlist.size()).second) return false;
+		itemlist.push_back(move(item));
+		return true;
+	}
+	const Item* FindItemById(int id) const
+	{
+		auto found = idIndex.find(id);
+		return found != end(idIndex) ? &AsItem(itemlist[found->second]) : nullptr;
+	}
+	void RemoveItemByName(const string& name)
+	{
+		uint32_t symbol = ItemNames().Find(name);
+		if (symbol == NameTable::npos) return;
+		if (!UseParallel())
+		{
+			EraseIf(0, [&](size_t row) { return AsItem(itemlist[row]).name.Symbol() == symbol; });
+			return;
+		}
+		// 이름 비교는 병렬로 해두고, 당겨오는 압축은 순서를 지키도록 한 번에 합니다.
+		vector<char> hits(itemlist.size());
+		std::transform(execution::par, begin(itemlist), end(itemlist), begin(hits), [&](auto& v) -> char { return AsItem(v).name.Symbol() == symbol; });
+		auto first = find(begin(hits), end(hits), 1);
+		if (first != end(hits)) EraseIf(first - begin(hits), [&](size_t row) { return hits[row] != 0; });
+	}
+	void RemoveItemById(int id)
+	{
+		auto found = idIndex.find(id);
+		if (found == end(idIndex)) return;
+		size_t pos = found->second;
+		EraseIf(pos, [&](size_t row) { return row == pos; });
+	}
+	void MergeItems(int id1, int id2, int newId)
+	{
+		auto found1 = idIndex.find(id1);
+		auto found2 = idIndex.find(id2);
+		if (id1 == id2 || found1 == end(idIndex) || found2 == end(idIndex)) return;
+		if (newId != id1 && newId != id2 && idIndex.count(newId)) return;
+
+		size_t pos1 = found1->second, pos2 = found2->second;
+		const Item& item1 = AsItem(itemlist[pos1]);
+		const Item& item2 = AsItem(itemlist[pos2]);
+		if (item1.grade == item2.grade)
+		{
+			Item newItem(newId, item1.name, 1, UpgradeGrade(item1.grade));
+			cout << newId << ' ' << newItem.name << ' ' << 1 << ' ' << newItem.grade << ' ' << endl;
+			EraseIf(min(pos1, pos2), [&](size_t row) { return row == pos1 || row == pos2; });
+			AddItem(move(newItem));
+		}
+	}
+	void WriteItems(ItemWriter& writer) const
+	{
+		for (auto& item : itemlist) writer.Write(AsItem(item));
+		writer.Flush();
+	}
+	void PrintItems()
+	{
+		if (UseParallel())
+		{
+			PrintItemsParallel(itemlist, [](auto& v) -> const Item& { return AsItem(v); });
+			return;
+		}
+		ItemWriter writer(cout);
+		WriteItems(writer);
+		cout << endl;
+	}
+	// 동점은 ItemByName, ItemByLevel 과 같은 순서로 갈라 직렬, 병렬 정렬 결과가 같습니다.
+	void SortByName()
+	{
+		SortBy([](const Item& a, const Item& b) { return ItemByName()(&a, &b); });
+	}
+	void SortByLevel()
+	{
+		SortBy([](const Item& a, const Item& b) { return ItemByLevel()(&a, &b); });
+	}
+};
+
+// level >= minLevel && grade == 등급 조건을 레벨, 등급 배열 위에서 검사해 선택 비트맵을 만듭니다.
+//	행 i 의 결과는 bitmap[i / 64] 의 i % 64 번째 비트이고, 비트맵은 (count + 63) / 64 워드를 모두 채웁니다.
+//	스칼라, SSE2(16행씩), AVX2(32행씩) 가 같은 결과를 내며, 실행 중인 CPU 에 맞는 것을 한 번 골라 씁니다.
+using LevelGradeKernel = void (*)(const int* levels, const char* grades, size_t count, int minLevel, char grade, uint64_t* bitmap);
+
+inline void SelectLevelGradeScalar(const int* levels, const char* grades, size_t count, int minLevel, char grade, uint64_t* bitmap)
+{
+	for (size_t word = 0; word * 64 < count; ++word)
+	{
+		uint64_t bits = 0;
+		size_t last = min<size_t>(64, count - word * 64);
+		for (size_t b = 0; b < last; ++b)
+		{
+			size_t i = word * 64 + b;
+			bits |= static_cast<uint64_t>((levels[i] >= minLevel) & (grades[i] == grade)) << b;
+		}
+		bitmap[word] = bits;
+	}
+}
+
+#ifdef ITEM_SIMD_X86
+inline void SelectLevelGradeSse2(const int* levels, const char* grades, size_t count, int minLevel, char grade, uint64_t* bitmap)
+{
+	const __m128i low = _mm_set1_epi32(minLevel);
+	const __m128i wanted = _mm_set1_epi8(grade);
+	size_t full = count / 64;
+	for (size_t word = 0; word < full; ++word)
+	{
+		uint64_t bits = 0;
+		for (size_t part = 0; part < 4; ++part)
+		{
+			size_t i = word * 64 + part * 16;
+			// minLevel > level 을 네 묶음 비교해 16비트로 모으고(부호 포화 압축은 0 / -1 을 그대로 유지), 등급 비교와 합칩니다.
+			__m128i below0 = _mm_cmpgt_epi32(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i)));
+			__m128i below1 = _mm_cmpgt_epi32(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i + 4)));
+			__m128i below2 = _mm_cmpgt_epi32(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i + 8)));
+			__m128i below3 = _mm_cmpgt_epi32(low, _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i + 12)));
+			__m128i below = _mm_packs_epi16(_mm_packs_epi32(below0, below1), _mm_packs_epi32(below2, below3));
+			__m128i same = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(grades + i)), wanted);
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_andnot_si128(below, same)));
+			bits |= static_cast<uint64_t>(mask) << (part * 16);
+		}
+		bitmap[word] = bits;
+	}
+	if (full * 64 < count) SelectLevelGradeScalar(levels + full * 64, grades + full * 64, count - full * 64, minLevel, grade, bitmap + full);
+}
+
+ITEM_TARGET_AVX2 inline void SelectLevelGradeAvx2(const int* levels, const char* grades, size_t count, int minLevel, char grade, uint64_t* bitmap)
+{
+	const __m256i low = _mm256_set1_epi32(minLevel);
+	const __m256i wanted = _mm256_set1_epi8(grade);
+	size_t full = count / 64;
+	for (size_t word = 0; word < full; ++word)
+	{
+		uint64_t bits = 0;
+		for (size_t part = 0; part < 2; ++part)
+		{
+			size_t i = word * 64 + part * 32;
+			// 레벨은 8행씩 비교해 부호 비트만 모읍니다. (256비트 압축 명령은 128비트 반쪽끼리 섞이므로 쓰지 않음)
+			uint32_t below = 0;
+			for (size_t k = 0; k < 4; ++k)
+			{
+				__m256i cmp = _mm256_cmpgt_epi32(low, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(levels + i + k * 8)));
+				below |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(cmp))) << (k * 8);
+			}
+			__m256i same = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(grades + i)), wanted);
+			uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(same)) & ~below;
+			bits |= static_cast<uint64_t>(mask) << (part * 32);
+		}
+		bitmap[word] = bits;
+	}
+	if (full * 64 < count) SelectLevelGradeScalar(levels + full * 64, grades + full * 64, count - full * 64, minLevel, grade, bitmap + full);
+}
+
+inline bool CpuHasAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;		// 운영체제가 YMM 레지스터를 저장해 주는지
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+inline const char* LevelGradeKernelName(LevelGradeKernel kernel)
+{
+#ifdef ITEM_SIMD_X86
+	if (kernel == SelectLevelGradeAvx2) return "avx2";
+	if (kernel == SelectLevelGradeSse2) return "sse2";
+#endif
+	return "scalar";
+}
+// 처음 부를 때 CPU 를 확인해 가장 넓은 커널을 고릅니다.
+inline LevelGradeKernel BestLevelGradeKernel()
+{
+#ifdef ITEM_SIMD_X86
+	static const LevelGradeKernel kernel = CpuHasAvx2() ? SelectLevelGradeAvx2 : SelectLevelGradeSse2;
+	return kernel;
+#else
+	return SelectLevelGradeScalar;
+#endif
+}
+// 비트맵에서 켜진 비트의 행 번호를 차례로 visit 에 넘깁니다.
+template<typename Visit>
+void ForEachSelected(const vector<uint64_t>& bitmap, Visit visit)
+{
+	for (size_t word = 0; word < bitmap.size(); ++word)
+	{
+		for (uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1)
+		{
+#if defined(_MSC_VER) && defined(_M_IX86)
+			unsigned long bit;
+			if (!_BitScanForward(&bit, static_cast<unsigned long>(bits))) { _BitScanForward(&bit, static_cast<unsigned long>(bits >> 32)); bit += 32; }
+#elif defined(_MSC_VER)
+			unsigned long bit;
+			_BitScanForward64(&bit, bits);
+#else
+			int bit = __builtin_ctzll(bits);
+#endif
+			visit(static_cast<uint32_t>(word * 64 + bit));
+		}
+	}
+}
+
+// 아이템 속성을 필드별 배열로 나눠 담는 ItemManager (Struct of Arrays)
+//	레벨 정렬은 levels 만, 이름 삭제는 nameSymbols 만 읽으므로 필요한 필드의 바이트만 훑습니다.
+//	levels, grades 처럼 단순한 배열 위의 조건 검사는 컴파일러가 벡터화하기 쉽습니다.
+class ColumnItemManager
+{
+	vector<int>				ids;
+	vector<int>				levels;
+	vector<char>			grades;
+	vector<uint32_t>		nameSymbols;	// ItemNames() 심볼
+	vector<ItemCategory>	categories;
+	vector<int>				stats;			// StatOf
+	unordered_map<int, size_t> idIndex;		// id -> 행 번호
+
+	template<typename T>
+	static void MoveRow(vector<T>& column, size_t from, size_t to) { column[to] = move(column[from]); }
+	template<typename T>
+	static void Permute(vector<T>& column, const vector<uint32_t>& order)
+	{
+		vector<T> sorted;
+		sorted.reserve(column.size());
+		for (uint32_t row : order) sorted.push_back(move(column[row]));
+		column.swap(sorted);
+	}
+
+	// from 이후 행 중 pred(row) 가 참인 행을 지우고, 모든 열을 같은 방식으로 한 번 당겨옵니다.
+	template<typename Pred>
+	void EraseRowsIf(size_t from, Pred pred)
+	{
+		size_t out = from;
+		for (size_t i = from; i < ids.size(); ++i)
+		{
+			if (pred(i)) { idIndex.erase(ids[i]); continue; }
+			if (out != i)
+			{
+				MoveRow(ids, i, out); MoveRow(levels, i, out); MoveRow(grades, i, out);
+				MoveRow(nameSymbols, i, out); MoveRow(categories, i, out); MoveRow(stats, i, out);
+			}
+			idIndex[ids[out]] = out;
+			++out;
+		}
+		ids.resize(out); levels.resize(out); grades.resize(out);
+		nameSymbols.resize(out); categories.resize(out); stats.resize(out);
+	}
+	// (정렬 키, 행 번호) 만 정렬한 뒤 모든 열을 그 순서로 재배치합니다.
+	//	키는 id 까지 포함해서 동점이 없게 만듭니다. (다른 매니저와 같은 순서)
+	template<typename Key>
+	void SortRowsBy(Key key)
+	{
+		vector<pair<decltype(key(0)), uint32_t>> keys(ids.size());
+		for (uint32_t i = 0; i < keys.size(); ++i) keys[i] = { key(i), i };
+		std::sort(begin(keys), end(keys), [](auto& a, auto& b) { return a.first < b.first; });
+
+		vector<uint32_t> order(keys.size());
+		for (size_t i = 0; i < keys.size(); ++i) order[i] = keys[i].second;
+		Permute(ids, order); Permute(levels, order); Permute(grades, order);
+		Permute(nameSymbols, order); Permute(categories, order); Permute(stats, order);
+		for (size_t i = 0; i < ids.size(); ++i) idIndex[ids[i]] = i;
+	}
 
 public:
-	void AddItem(const shared_ptr<Item>& item) { itemlist.push_back(item); }
+	void Reserve(size_t count)
+	{
+		ids.reserve(count); levels.reserve(count); grades.reserve(count);
+		nameSymbols.reserve(count); categories.reserve(count); stats.reserve(count);
+		idIndex.reserve(count);
+	}
+	size_t Size() const { return ids.size(); }
+
+	bool AddItem(const ItemValue& value)
+	{
+		const Item& item = AsItem(value);
+		if (!idIndex.emplace(item.id, ids.size()).second) return false;
+		ids.push_back(item.id);
+		levels.push_back(item.level);
+		grades.push_back(item.grade);
+		nameSymbols.push_back(item.name.Symbol());
+		categories.push_back(item.category);
+		stats.push_back(StatOf(item));
+		return true;
+	}
+	// 행 하나를 다시 값 객체로 조립합니다.
+	ItemValue GetItem(size_t row) const
+	{
+		const string& name = ItemNames().Name(nameSymbols[row]);
+		switch (categories[row])
+		{
+		case ItemCategory::Weapon: { Weapon w(ids[row], name, levels[row], grades[row]); w.attack = stats[row]; return w; }
+		case ItemCategory::Armor: { Armor a(ids[row], name, levels[row], grades[row]); a.defence = stats[row]; return a; }
+		case ItemCategory::Ring: { Ring r(ids[row], name, levels[row], grades[row]); r.magic = stats[row]; return r; }
+		default: return Item(ids[row], name, levels[row], grades[row]);
+		}
+	}
 	void RemoveItemByName(const string& name)
 	{
-		itemlist.erase(remove_if(begin(itemlist), end(itemlist), [&](auto& a) { return a->name == name; }), end(itemlist));
+		uint32_t symbol = ItemNames().Find(name);
+		if (symbol == NameTable::npos) return;
+		EraseRowsIf(0, [&](size_t row) { return nameSymbols[row] == symbol; });
 	}
 	void RemoveItemById(int id)
 	{
-		itemlist.erase(remove_if(begin(itemlist), end(itemlist), [&](auto& a) { return a->id == id; }), end(itemlist));
+		auto found = idIndex.find(id);
+		if (found == end(idIndex)) return;
+		EraseRowsIf(found->second, [&](size_t row) { return ids[row] == id; });
 	}
 	void MergeItems(int id1, int id2, int newId)
 	{
-		auto it1 = find_if(begin(itemlist), end(itemlist), [&](auto& a) { return a->id == id1; });
-		auto it2 = find_if(begin(itemlist), end(itemlist), [&](auto& a) { return a->id == id2; });
-		if (it1 != end(itemlist) && it2 != end(itemlist) && (*it1)->grade == (*it2)->grade)
+		auto found1 = idIndex.find(id1);
+		auto found2 = idIndex.find(id2);
+		if (id1 == id2 || found1 == end(idIndex) || found2 == end(idIndex)) return;
+		if (newId != id1 && newId != id2 && idIndex.count(newId)) return;
+
+		size_t row1 = found1->second, row2 = found2->second;
+		if (grades[row1] == grades[row2])
 		{
-			char newGrade = ((*it1)->grade == 'S') ? 'S' : (*it1)->grade - 1;
-			auto newItem = make_shared<Item>(newId, (*it1)->name, 1, newGrade);
-			cout << newId << ' ' << (*it1)->name << ' ' << 1 << ' ' << newGrade << ' ' << endl;
-			itemlist.push_back(newItem);
-			RemoveItemById(id1);
-			RemoveItemById(id2);
+			Item newItem(newId, ItemNames().Name(nameSymbols[row1]), 1, UpgradeGrade(grades[row1]));
+			cout << newId << ' ' << newItem.name << ' ' << 1 << ' ' << newItem.grade << ' ' << endl;
+			EraseRowsIf(min(row1, row2), [&](size_t row) { return ids[row] == id1 || ids[row] == id2; });
+			AddItem(newItem);
 		}
 	}
+	// level >= minLevel 이고 grade 가 같은 행의 선택 비트맵. (행 i 는 [i / 64] 워드의 i % 64 비트)
+	// 두 열만 순서대로 읽으며 CPU 에 맞는 SIMD 커널로 검사합니다.
+	vector<uint64_t> SelectByLevelAndGrade(int minLevel, char grade, LevelGradeKernel kernel = BestLevelGradeKernel()) const
+	{
+		vector<uint64_t> bitmap((ids.size() + 63) / 64);
+		kernel(levels.data(), grades.data(), ids.size(), minLevel, grade, bitmap.data());
+		return bitmap;
+	}
+	// 같은 조건의 행 번호 목록
+	vector<uint32_t> FilterByLevelAndGrade(int minLevel, char grade) const
+	{
+		vector<uint64_t> bitmap = SelectByLevelAndGrade(minLevel, grade);
+		size_t count = 0;
+		for (uint64_t bits : bitmap) count += bitset<64>(bits).count();
+		vector<uint32_t> rows;
+		rows.reserve(count);
+		ForEachSelected(bitmap, [&](uint32_t row) { rows.push_back(row); });
+		return rows;
+	}
+	void WriteItems(ItemWriter& writer) const
+	{
+		for (size_t i = 0; i < ids.size(); ++i) writer.Write(ids[i], ItemNames().Name(nameSymbols[i]), levels[i], grades[i]);
+		writer.Flush();
+	}
 	void PrintItems()
 	{
-		std::for_each(begin(itemlist), end(itemlist), [](auto& a) {  cout << a->id << " " << a->name << " " << a->grade << endl; });
+		ItemWriter writer(cout);
+		WriteItems(writer);
 		cout << endl;
 	}
 	void SortByName()
 	{
-		std::sort(begin(itemlist), end(itemlist), [](auto& a, auto& b) { return a->name < b->name;   });
+		// 이름 테이블이 관리하는 순위로 정렬하므로 문자열 비교가 없습니다.
+		vector<uint32_t> ranks = ItemNames().Ranks();
+		SortRowsBy([&](size_t row) { return make_pair(ranks[nameSymbols[row]], ids[row]); });
 	}
 	void SortByLevel()
 	{
-		std::sort(begin(itemlist), end(itemlist), [](auto& a, auto& b) { return a->level < b->level;   });
+		// 레벨이 같으면 이름, id 순
+		vector<uint32_t> ranks = ItemNames().Ranks();
+		SortRowsBy([&](size_t row) { return make_tuple(levels[row], ranks[nameSymbols[row]], ids[row]); });
+	}
+};
+
+// 종류별 값 벡터 묶음 : 다루는 종류가 컴파일 시간에 정해지므로, 종류별 작업은 가상 호출 없이 해당 벡터에서 바로 처리합니다.
+//	예) TypedInventory<Item, Weapon, Armor, Ring> inventory;  inventory.ForEach<Weapon>([](Weapon& w) { ... });
+//	각 벡터는 id 순으로 정렬되어 있어 id 찾기는 이진 탐색이고, 종류를 넘나드는 id 순 순회는 벡터 머리들을 병합해서 합니다.
+//	id 는 모든 종류를 통틀어 중복되지 않습니다.
+template<typename... Ts>
+class TypedInventory
+{
+	static constexpr size_t kTypeCount = sizeof...(Ts);
+	tuple<vector<Ts>...> lists;
+
+	template<typename T>
+	static auto LowerBound(vector<T>& list, int id) { return lower_bound(begin(list), end(list), id, [](const T& item, int key) { return item.id < key; }); }
+	template<typename T>
+	static auto LowerBound(const vector<T>& list, int id) { return lower_bound(begin(list), end(list), id, [](const T& item, int key) { return item.id < key; }); }
+
+	template<size_t... I>
+	void FindNext(const array<size_t, kTypeCount>& cursor, size_t& best, int& bestId, index_sequence<I...>) const
+	{
+		((cursor[I] < get<I>(lists).size() && (best == kTypeCount || get<I>(lists)[cursor[I]].id < bestId)
+			? (best = I, bestId = get<I>(lists)[cursor[I]].id, 0) : 0), ...);
+	}
+	template<typename Visit, size_t... I>
+	void VisitAt(size_t which, array<size_t, kTypeCount>& cursor, Visit& visit, index_sequence<I...>) const
+	{
+		((I == which ? (visit(get<I>(lists)[cursor[I]++]), 0) : 0), ...);
+	}
+
+public:
+	template<typename T> vector<T>& Items() { return get<vector<T>>(lists); }
+	template<typename T> const vector<T>& Items() const { return get<vector<T>>(lists); }
+	template<typename T> void Reserve(size_t count) { Items<T>().reserve(count); }
+	size_t Size() const { return (get<vector<Ts>>(lists).size() + ...); }
+	void Clear() { (get<vector<Ts>>(lists).clear(), ...); }
+
+	bool Contains(int id) const
+	{
+		return ((LowerBound(get<vector<Ts>>(lists), id) != end(get<vector<Ts>>(lists)) && LowerBound(get<vector<Ts>>(lists), id)->id == id) || ...);
+	}
+	// 같은 id 가 이미 있으면 추가하지 않고 false. 보통 id 가 커지는 순서로 들어오므로 대개 맨 뒤에 붙습니다.
+	template<typename T>
+	bool AddItem(T item)
+	{
+		if (Contains(item.id)) return false;
+		vector<T>& list = Items<T>();
+		if (list.empty() || list.back().id < item.id) list.push_back(move(item));
+		else list.insert(LowerBound(list, item.id), move(item));
+		return true;
+	}
+	template<typename T>
+	T* Find(int id)
+	{
+		vector<T>& list = Items<T>();
+		auto found = LowerBound(list, id);
+		return found != end(list) && found->id == id ? &*found : nullptr;
+	}
+	bool RemoveItemById(int id)
+	{
+		auto remove = [id](auto& list) {
+			auto found = LowerBound(list, id);
+			if (found == end(list) || found->id != id) return false;
+			list.erase(found);
+			return true;
+		};
+		return (remove(get<vector<Ts>>(lists)) || ...);
+	}
+	void RemoveItemByName(const string& name)
+	{
+		uint32_t symbol = ItemNames().Find(name);
+		if (symbol == NameTable::npos) return;
+		auto remove = [symbol](auto& list) {
+			list.erase(remove_if(begin(list), end(list), [symbol](const Item& item) { return item.name.Symbol() == symbol; }), end(list));
+		};
+		(remove(get<vector<Ts>>(lists)), ...);
+	}
+
+	// 한 종류만 순회 : visit 는 T& 를 받습니다.
+	template<typename T, typename Visit>
+	void ForEach(Visit visit) { for (T& item : Items<T>()) visit(item); }
+	template<typename T, typename Visit>
+	void ForEach(Visit visit) const { for (const T& item : Items<T>()) visit(item); }
+	// 모든 종류를 종류 순서대로 순회 : visit 는 각 종류의 실제 타입으로 불립니다. (제네릭 람다)
+	template<typename Visit>
+	void ForEachAll(Visit visit) const { (ForEach<Ts>(visit), ...); }
+	// 모든 종류를 id 순으로 순회 : 종류별 벡터의 머리 중 가장 작은 id 를 골라 넘기는 병합입니다. 추가 메모리가 없습니다.
+	template<typename Visit>
+	void VisitInIdOrder(Visit visit) const
+	{
+		array<size_t, kTypeCount> cursor{};
+		for (;;)
+		{
+			size_t best = kTypeCount;
+			int bestId = 0;
+			FindNext(cursor, best, bestId, index_sequence_for<Ts...>());
+			if (best == kTypeCount) return;
+			VisitAt(best, cursor, visit, index_sequence_for<Ts...>());
+		}
+	}
+
+	void WriteItems(ItemWriter& writer) const
+	{
+		VisitInIdOrder([&](const Item& item) { writer.Write(item); });
+		writer.Flush();
+	}
+	void PrintItems() const
+	{
+		ItemWriter writer(cout);
+		WriteItems(writer);
+		cout << endl;
+	}
+};
+
+// 여러 스레드가 함께 쓰는 매니저 : 아이템을 id 해시로 샤드에 나누고, 샤드마다 읽기/쓰기 잠금을 따로 둡니다.
+//	id 하나만 다루는 추가, 삭제, 찾기는 해당 샤드만 잠그므로 서로 다른 샤드의 작업은 동시에 진행됩니다.
+//	여러 샤드에 걸친 합성은 관련 샤드를 번호 순서대로 모두 잠근 뒤 처리하므로 교착 없이 한 번에 반영됩니다.
+//	RemoveItemByName, PrintItems 처럼 모든 샤드를 보는 작업은 샤드를 하나씩 잠그며, 샤드 사이에 원자적이지는 않습니다.
+//	출력 순서는 ItemManager 와 같은 추가 순서입니다. (추가할 때 매긴 순번으로 정렬)
+class ConcurrentItemManager
+{
+	struct Entry
+	{
+		shared_ptr<Item> item;
+		uint64_t sequence;
+	};
+	struct alignas(64) Shard				// 샤드끼리 같은 캐시 라인을 쓰지 않도록
+	{
+		mutable shared_mutex lock;
+		unordered_map<int, Entry> items;
+		unordered_map<uint32_t, unordered_set<int>> nameIndex;		// 이름 심볼 -> id
+
+		void Insert(const shared_ptr<Item>& item, uint64_t sequence)
+		{
+			items.emplace(item->id, Entry{ item, sequence });
+			nameIndex[item->name.Symbol()].insert(item->id);
+		}
+		void Erase(unordered_map<int, Entry>::iterator found)
+		{
+			auto names = nameIndex.find(found->second.item->name.Symbol());
+			names->second.erase(found->first);
+			if (names->second.empty()) nameIndex.erase(names);
+			items.erase(found);
+		}
+	};
+
+	size_t shardMask;
+	unique_ptr<Shard[]> shards;
+	atomic<uint64_t> nextSequence{ 0 };
+
+	size_t ShardOf(int id) const
+	{
+		// 연속된 id 가 고르게 퍼지도록 섞습니다. (피보나치 해싱)
+		return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15ull) >> 32) & shardMask;
+	}
+	vector<Entry> Collect() const
+	{
+		vector<Entry> entries;
+		for (size_t i = 0; i <= shardMask; ++i)
+		{
+			shared_lock<shared_mutex> reading(shards[i].lock);
+			for (auto& [id, entry] : shards[i].items) entries.push_back(entry);
+		}
+		sort(begin(entries), end(entries), [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+		return entries;
+	}
+
+public:
+	// 샤드 수는 2의 거듭제곱으로 올림합니다. 스레드 수의 몇 배 정도면 충돌이 드뭅니다.
+	explicit ConcurrentItemManager(size_t shardCount = 64)
+	{
+		size_t count = 1;
+		while (count < shardCount) count <<= 1;
+		shardMask = count - 1;
+		shards = make_unique<Shard[]>(count);
+	}
+
+	// 같은 id 가 이미 있으면 추가하지 않고 false
+	bool AddItem(const shared_ptr<Item>& item)
+	{
+		Shard& shard = shards[ShardOf(item->id)];
+		unique_lock<shared_mutex> writing(shard.lock);
+		if (shard.items.count(item->id)) return false;
+		shard.Insert(item, nextSequence.fetch_add(1, memory_order_relaxed));
+		return true;
+	}
+	// 돌려받은 shared_ptr 은 그 사이 아이템이 지워져도 유효합니다. 이름 색인이 있으므로 읽기 전용입니다.
+	shared_ptr<const Item> FindItemById(int id) const
+	{
+		const Shard& shard = shards[ShardOf(id)];
+		shared_lock<shared_mutex> reading(shard.lock);
+		auto found = shard.items.find(id);
+		return found != end(shard.items) ? found->second.item : nullptr;
+	}
+	void RemoveItemById(int id)
+	{
+		Shard& shard = shards[ShardOf(id)];
+		unique_lock<shared_mutex> writing(shard.lock);
+		auto found = shard.items.find(id);
+		if (found != end(shard.items)) shard.Erase(found);
+	}
+	void RemoveItemByName(const string& name)
+	{
+		uint32_t symbol = ItemNames().Find(name);
+		if (symbol == NameTable::npos) return;
+		for (size_t i = 0; i <= shardMask; ++i)
+		{
+			Shard& shard = shards[i];
+			unique_lock<shared_mutex> writing(shard.lock);
+			auto names = shard.nameIndex.find(symbol);
+			if (names == end(shard.nameIndex)) continue;
+			for (int id : names->second) shard.items.erase(id);
+			shard.nameIndex.erase(names);
+		}
+	}
+	// ItemManager::MergeItems 와 같은 규칙입니다. 재료 두 개와 결과 id 의 샤드를 함께 잠그고 처리합니다.
+	bool MergeItems(int id1, int id2, int newId)
+	{
+		if (id1 == id2) return false;
+		size_t order[3] = { ShardOf(id1), ShardOf(id2), ShardOf(newId) };
+		sort(begin(order), end(order));
+		size_t* last = unique(begin(order), end(order));
+		vector<unique_lock<shared_mutex>> locks;
+		for (size_t* i = order; i != last; ++i) locks.emplace_back(shards[*i].lock);
+
+		Shard& shard1 = shards[ShardOf(id1)];
+		Shard& shard2 = shards[ShardOf(id2)];
+		Shard& newShard = shards[ShardOf(newId)];
+		auto found1 = shard1.items.find(id1);
+		auto found2 = shard2.items.find(id2);
+		if (found1 == end(shard1.items) || found2 == end(shard2.items)) return false;
+		if (newId != id1 && newId != id2 && newShard.items.count(newId)) return false;
+		auto item1 = found1->second.item;
+		auto item2 = found2->second.item;
+		if (item1->grade != item2->grade) return false;
+
+		char newGrade = UpgradeGrade(item1->grade);
+		auto newItem = make_shared<Item>(newId, item1->name, 1, newGrade);
+		shard1.Erase(found1);
+		shard2.Erase(found2);
+		newShard.Insert(newItem, nextSequence.fetch_add(1, memory_order_relaxed));
+		locks.clear();
+
+		// 여러 스레드가 합성해도 줄이 섞이지 않도록 한 줄을 만들어 한 번에 씁니다.
+		cout << (to_string(newId) + ' ' + newItem->name.str() + " 1 " + newGrade + " \n") << flush;
+		return true;
+	}
+	void Clear()
+	{
+		for (size_t i = 0; i <= shardMask; ++i)
+		{
+			unique_lock<shared_mutex> writing(shards[i].lock);
+			shards[i].items.clear();
+			shards[i].nameIndex.clear();
+		}
+	}
+	size_t Size() const
+	{
+		size_t size = 0;
+		for (size_t i = 0; i <= shardMask; ++i)
+		{
+			shared_lock<shared_mutex> reading(shards[i].lock);
+			size += shards[i].items.size();
+		}
+		return size;
+	}
+	void WriteItems(ItemWriter& writer) const
+	{
+		for (auto& entry : Collect()) writer.Write(*entry.item);
+		writer.Flush();
+	}
+	void PrintItems() const
+	{
+		ItemWriter writer(cout);
+		WriteItems(writer);
+		cout << endl;
 	}
 };
 
+// ItemManager(shared_ptr), FlatItemManager(값 저장), ColumnItemManager(필드별 배열) 의 추가, 정렬, 삭제 시간을 비교합니다.
+template<typename Func>
+double MeasureMs(Func func)
+{
+	auto start = chrono::steady_clock::now();
+	func();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// 벤치마크 아이템 i : 이름 다섯 가지를 차례로, 레벨은 0~99 에 흩어지게, 등급은 A~D 를 차례로 씁니다.
+const string& BenchmarkItemName(int i)
+{
+	static const string itemNames[] = { "단검", "장검", "갑옷", "투구", "반지" };
+	return itemNames[i % 5];
+}
+int BenchmarkItemLevel(int i) { return (i * 7919) % 100; }
+char BenchmarkItemGrade(int i) { return static_cast<char>('A' + i % 4); }
+// manager 의 풀로 벤치마크 아이템 i 를 만듭니다. 종류는 Kind, Rest... 중 kind 번째입니다.
+template<typename Kind, typename... Rest>
+shared_ptr<Item> MakeBenchmarkItem(ItemManager& manager, size_t kind, int i, int level, char grade)
+{
+	if constexpr (sizeof...(Rest) > 0)
+		if (kind > 0) return MakeBenchmarkItem<Rest...>(manager, kind - 1, i, level, grade);
+	return manager.MakeItem<Kind>(i, BenchmarkItemName(i), level, grade);
+}
+// id 0 ~ count-1 의 벤치마크 아이템을 manager 에 추가합니다. 종류는 Kinds 를 id 순서대로 돌려 쓰고,
+//	레벨, 등급은 level(i), grade(i) 로 정합니다.
+template<typename... Kinds, typename Level, typename Grade>
+void FillBenchmarkItems(ItemManager& manager, int count, Level level, Grade grade)
+{
+	for (int i = 0; i < count; ++i) manager.AddItem(MakeBenchmarkItem<Kinds...>(manager, i % sizeof...(Kinds), i, level(i), grade(i)));
+}
+
+void BenchmarkItemStorage(int count)
+{
+	auto makeName = BenchmarkItemName;
+	auto makeLevel = BenchmarkItemLevel;
+	auto makeGrade = BenchmarkItemGrade;
+
+	ItemManager shared;
+	FlatItemManager flat;
+	ColumnItemManager column;
+	flat.Reserve(count);
+	column.Reserve(count);
+
+	double sharedAdd = MeasureMs([&] {
+		for (int i = 0; i < count; ++i)
+		{
+			if (i % 2) shared.AddItem(make_shared<Weapon>(i, makeName(i), makeLevel(i), makeGrade(i)));
+			else shared.AddItem(make_shared<Armor>(i, makeName(i), makeLevel(i), makeGrade(i)));
+		}
+	});
+	double flatAdd = MeasureMs([&] {
+		for (int i = 0; i < count; ++i)
+		{
+			if (i % 2) flat.AddItem(Weapon(i, makeName(i), makeLevel(i), makeGrade(i)));
+			else flat.AddItem(Armor(i, makeName(i), makeLevel(i), makeGrade(i)));
+		}
+	});
+	double columnAdd = MeasureMs([&] {
+		for (int i = 0; i < count; ++i)
+		{
+			if (i % 2) column.AddItem(Weapon(i, makeName(i), makeLevel(i), makeGrade(i)));
+			else column.AddItem(Armor(i, makeName(i), makeLevel(i), makeGrade(i)));
+		}
+	});
+	double sharedLevel = MeasureMs([&] { shared.SortByLevel(); });
+	double flatLevel = MeasureMs([&] { flat.SortByLevel(); });
+	double columnLevel = MeasureMs([&] { column.SortByLevel(); });
+	double sharedName = MeasureMs([&] { shared.SortByName(); });
+	double flatName = MeasureMs([&] { flat.SortByName(); });
+	double columnName = MeasureMs([&] { column.SortByName(); });
+	double sharedRemove = MeasureMs([&] { shared.RemoveItemByName("반지"); });
+	double flatRemove = MeasureMs([&] { flat.RemoveItemByName("반지"); });
+	double columnRemove = MeasureMs([&] { column.RemoveItemByName("반지"); });
+	size_t selected = 0;
+	double columnFilter = MeasureMs([&] { selected = column.FilterByLevelAndGrade(50, 'A').size(); });
+
+	cout << "items: " << count << " (ms, shared_ptr / flat / column)" << endl;
+	cout << "AddItem          " << sharedAdd << " / " << flatAdd << " / " << columnAdd << endl;
+	cout << "SortByLevel      " << sharedLevel << " / " << flatLevel << " / " << columnLevel << endl;
+	cout << "SortByName       " << sharedName << " / " << flatName << " / " << columnName << endl;
+	cout << "RemoveItemByName " << sharedRemove << " / " << flatRemove << " / " << columnRemove << endl;
+	cout << "level >= 50 && grade == 'A' (column) " << columnFilter << " ms, " << selected << " items" << endl;
+	cout << endl;
+}
+
+// make_shared 와 매니저 풀(MakeItem) 의 생성, 해제 시간을 비교합니다.
+void BenchmarkItemAllocation(int count)
+{
+	vector<shared_ptr<Item>> items;
+	items.reserve(count);
+	double heapMs = MeasureMs([&] {
+		for (int i = 0; i < count; ++i)
+		{
+			if (i % 2) items.push_back(make_shared<Weapon>(i, "단검", 1, 'A'));
+			else items.push_back(make_shared<Armor>(i, "갑옷", 1, 'B'));
+		}
+		items.clear();
+	});
+
+	ItemManager manager;
+	double arenaMs = MeasureMs([&] {
+		for (int i = 0; i < count; ++i)
+		{
+			if (i % 2) items.push_back(manager.MakeItem<Weapon>(i, "단검", 1, 'A'));
+			else items.push_back(manager.MakeItem<Armor>(i, "갑옷", 1, 'B'));
+		}
+		items.clear();
+	});
+
+	const ItemArena::Stats& stats = manager.AllocatorStats();
+	cout << "items: " << count << " create + destroy (ms, make_shared / arena) " << heapMs << " / " << arenaMs << endl;
+	cout << "arena allocations " << stats.allocations << ", frees " << stats.frees << ", reused " << stats.reused
+		<< ", live bytes " << stats.liveBytes << ", reserved bytes " << stats.reservedBytes << ", chunks " << stats.chunkCount << endl;
+	cout << endl;
+}
+
+// 스냅샷 저장, 불러오기 시간을 잽니다.
+void BenchmarkSnapshot(int count, const string& path)
+{
+	ItemManager source;
+	source.Reserve(count);
+	FillBenchmarkItems<Armor, Weapon>(source, count, BenchmarkItemLevel, BenchmarkItemGrade);
+
+	ItemManager loaded;
+	bool saved = false, restored = false;
+	double saveMs = MeasureMs([&] { saved = source.SaveSnapshot(path); });
+	double loadMs = MeasureMs([&] { restored = loaded.LoadSnapshot(path); });
+	cout << "items: " << count << " snapshot save " << saveMs << " ms" << (saved ? "" : " (failed)")
+		<< ", load " << loadMs << " ms" << (restored ? "" : " (failed)") << endl;
+	cout << endl;
+}
+
+// 저널을 붙였을 때와 아닐 때의 변경 처리 시간을 그룹 크기별로 비교합니다. (추가 4 : id 삭제 1)
+//	전체 시간 차이는 잡음이 커서, 같은 레코드를 저널에만 쓰는 시간(기록 + write + fsync)도 따로 잽니다.
+void BenchmarkJournal(int count, const string& path)
+{
+	auto run = [&](ItemManager& manager) {
+		return MeasureMs([&] {
+			for (int i = 0; i < count; ++i)
+			{
+				if (i % 5 == 4) manager.RemoveItemById(i - 2);
+				else manager.AddItem(manager.MakeItem<Weapon>(i, BenchmarkItemName(i), i % 100, 'B'));
+			}
+		});
+	};
+	vector<Weapon> records;
+	records.reserve(count);
+	for (int i = 0; i < count; ++i) records.emplace_back(i, BenchmarkItemName(i), i % 100, 'B');
+
+	// 번갈아 다섯 번씩 돌려 가장 빠른 값끼리 비교합니다.
+	for (size_t groupSize : { size_t(1024), size_t(8192), size_t(65536) })
+	{
+		double memoryMs = numeric_limits<double>::max(), journalMs = numeric_limits<double>::max(), logMs = numeric_limits<double>::max();
+		ItemJournal::Stats stats;
+		for (int trial = 0; trial < 5; ++trial)
+		{
+			ItemManager memory;
+			memoryMs = min(memoryMs, run(memory));
+
+			filesystem::remove(path);
+			ItemManager journaled;
+			ItemJournal journal(path);
+			journal.SetGroupCommit(groupSize);
+			journaled.AttachJournal(&journal);
+			journalMs = min(journalMs, run(journaled) + MeasureMs([&] { journal.Flush(); }));
+			stats = journal.GetStats();
+
+			filesystem::remove(path);
+			ItemJournal alone(path);
+			alone.SetGroupCommit(groupSize);
+			logMs = min(logMs, MeasureMs([&] {
+				for (int i = 0; i < count; ++i)
+				{
+					if (i % 5 == 4) alone.LogRemoveById(i - 2);
+					else alone.LogAdd(records[i], Weapon::kCategory, 0);
+				}
+				alone.Flush();
+			}));
+		}
+		cout << "mutations: " << count << ", group " << groupSize << " (ms, memory / journal) " << memoryMs << " / " << journalMs
+			<< ", journal work " << logMs << " ms (+" << logMs / memoryMs * 100 << "%), fsync " << stats.flushes << ", bytes " << stats.bytes << endl;
+	}
+	cout << endl;
+}
+
+// 아이템마다 ostream << endl 로 쓰는 기존 방식과 ItemWriter 를 파일 출력으로 비교합니다.
+void BenchmarkItemOutput(int count, const string& path)
+{
+	ItemManager manager;
+	manager.Reserve(count);
+	FillBenchmarkItems<Weapon>(manager, count, [](int i) { return i % 100; }, [](int) { return 'B'; });
+
+	double streamMs = MeasureMs([&] {
+		ofstream out(path);
+		for (auto& item : manager.ItemsByName()) out << item->id << " " << item->name << " " << item->grade << endl;
+	});
+	double writerMs = MeasureMs([&] {
+		ofstream out(path);
+		ItemWriter writer(out);
+		for (auto& item : manager.ItemsByName()) writer.Write(*item);
+	});
+	double csvMs = MeasureMs([&] {
+		ofstream out(path);
+		ItemWriter writer(out, ItemFormat::Csv);
+		for (auto& item : manager.ItemsByName()) writer.Write(*item);
+	});
+	filesystem::remove(path);
+
+	cout << "items: " << count << " (ms, ostream+endl / ItemWriter / ItemWriter csv) "
+		<< streamMs << " / " << writerMs << " / " << csvMs << endl;
+	cout << endl;
+}
+
+// 섞인 작업(찾기 50%, 추가 25%, 삭제 25%)을 스레드 수를 늘려가며, 샤드 하나(전역 잠금)와 샤드 64개로 비교합니다.
+void BenchmarkConcurrentItems(int opsPerThread)
+{
+	auto run = [&](int threadCount, auto add, auto find, auto remove) {
+		return MeasureMs([&] {
+			vector<thread> threads;
+			for (int t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&, t] {
+					int base = t * opsPerThread;
+					for (int i = 0; i < opsPerThread; ++i)
+					{
+						int id = base + i / 2;
+						switch (i % 4)
+						{
+						case 0: add(make_shared<Weapon>(id, "단검", i % 100, 'B')); break;
+						case 2: remove(base + i / 4); break;
+						default: find(id); break;
+						}
+					}
+				});
+			}
+			for (auto& worker : threads) worker.join();
+		});
+	};
+
+	cout << "threads / mixed ops (ms, global mutex | sharded)" << endl;
+	for (int threadCount : { 1, 2, 4, 8, 16, 32 })
+	{
+		ConcurrentItemManager locked(1), sharded;
+		auto runOn = [&](ConcurrentItemManager& manager) {
+			return run(threadCount,
+				[&](const shared_ptr<Item>& item) { manager.AddItem(item); },
+				[&](int id) { return manager.FindItemById(id); },
+				[&](int id) { manager.RemoveItemById(id); });
+		};
+		double lockedMs = runOn(locked);
+		double shardedMs = runOn(sharded);
+
+		cout << threadCount << " / " << lockedMs << " | " << shardedMs << endl;
+	}
+	cout << endl;
+}
+
+// 쓰는 스레드 하나가 추가, 삭제를 하는 동안 읽는 스레드들이 목록 전체를 반복해서 훑습니다.
+// 잠금으로 itemlist 를 함께 쓰는 방식과, 1000 번 변경마다 발행한 버전을 잠금 없이 읽는 방식을 비교합니다.
+void BenchmarkReadVersions(int count, int readerCount)
+{
+	auto run = [&](bool versioned) {
+		ItemManager manager;
+		FillBenchmarkItems<Weapon>(manager, count, [](int i) { return i % 100; }, [](int) { return 'B'; });
+		manager.PublishVersion();
+		mutex lock;
+		atomic<bool> done{ false };
+		atomic<size_t> passes{ 0 };
+
+		vector<thread> readers;
+		for (int r = 0; r < readerCount; ++r)
+		{
+			readers.emplace_back([&] {
+				while (!done.load())
+				{
+					size_t high = 0;
+					if (versioned)
+					{
+						ItemListVersion version = manager.ReadVersion();
+						for (auto& item : *version) high += item->level >= 50;
+					}
+					else
+					{
+						lock_guard<mutex> guard(lock);
+						for (const Item* item : manager.ItemsByLevel()) high += item->level >= 50;
+					}
+					passes.fetch_add(high > 0);
+				}
+			});
+		}
+		double writerMs = MeasureMs([&] {
+			for (int i = 0; i < count / 10; ++i)
+			{
+				{
+					unique_lock<mutex> guard(lock, defer_lock);
+					if (!versioned) guard.lock();
+					manager.AddItem(manager.MakeItem<Weapon>(count + i, BenchmarkItemName(i), i % 100, 'A'));
+					manager.RemoveItemById(count + i - 1);		// 목록 끝쪽만 바꿔 압축 비용은 작게
+				}
+				if (versioned && i % 1000 == 999) manager.PublishVersion();
+			}
+		});
+		done = true;
+		for (auto& reader : readers) reader.join();
+		cout << (versioned ? "versions " : "mutex    ") << "writer " << writerMs << " ms, reader passes " << passes.load()
+			<< ", retired versions " << manager.RetiredVersions() << endl;
+	};
+	cout << "items: " << count << ", readers: " << readerCount << endl;
+	run(false);
+	run(true);
+	cout << endl;
+}
+
+// 레벨 10~20 아이템, A 등급 상위 50개를 찾는 시간을 전체 정렬 후 훑기와 레벨 색인으로 비교합니다.
+void BenchmarkLevelQueries(int count)
+{
+	ItemManager manager;
+	FillBenchmarkItems<Weapon>(manager, count, BenchmarkItemLevel, BenchmarkItemGrade);
+
+	size_t inRange = 0, top = 0;
+	double sortMs = MeasureMs([&] {
+		FlatItemManager flat;
+		flat.Reserve(count);
+		for (int i = 0; i < count; ++i) flat.AddItem(Weapon(i, BenchmarkItemName(i), BenchmarkItemLevel(i), BenchmarkItemGrade(i)));
+		flat.SortByLevel();
+		for (auto& value : flat.Items()) inRange += AsItem(value).level >= 10 && AsItem(value).level <= 20;
+	});
+	double rangeMs = MeasureMs([&] { inRange = manager.ItemsInLevelRange(10, 20).size(); });
+	double topMs = MeasureMs([&] { top = manager.TopByLevel(50, 'A').size(); });
+
+	cout << "items: " << count << " level 10~20 (ms, copy + sort + scan / index) " << sortMs << " / " << rangeMs << ", " << inRange << " items" << endl;
+	cout << "top 50 of grade A " << topMs << " ms, " << top << " items" << endl;
+	cout << endl;
+}
+
+// "A 등급, 레벨 10~20 인 단검을 레벨 높은 순으로 20개" 를 손으로 쓴 copy_if + sort 와 ItemQuery 로 비교합니다.
+void BenchmarkItemQuery(int count)
+{
+	ItemManager manager;
+	vector<const Item*> all;
+	for (int i = 0; i < count; ++i)
+	{
+		auto item = MakeBenchmarkItem<Weapon>(manager, 0, i, BenchmarkItemLevel(i), BenchmarkItemGrade(i));
+		manager.AddItem(item);
+		all.push_back(item.get());
+	}
+
+	vector<const Item*> byHand;
+	double handMs = MeasureMs([&] {
+		copy_if(begin(all), end(all), back_inserter(byHand), [](const Item* item) {
+			return item->grade == 'A' && item->level >= 10 && item->level <= 20 && item->name == "단검";
+		});
+		sort(begin(byHand), end(byHand), [](const Item* a, const Item* b) { return a->level > b->level; });
+		if (byHand.size() > 20) byHand.resize(20);
+	});
+	size_t found = 0;
+	double queryMs = MeasureMs([&] {
+		auto query = ItemQuery().WhereGrade('A').WhereLevel(10, 20).WhereName("단검").OrderBy(ItemQuery::Order::LevelDescending).Limit(20);
+		found = manager.Query(query, [](const Item&) {});
+	});
+
+	cout << "items: " << count << " (ms, copy_if + sort / ItemQuery) " << handMs << " / " << queryMs
+		<< ", " << byHand.size() << " / " << found << " items" << endl;
+	cout << endl;
+}
+
+// level >= 50 && grade == 'A' 선택 비트맵을 커널별로 만들어 시간과 읽은 바이트 기준 처리량을 비교합니다.
+void BenchmarkLevelGradeFilter(int count)
+{
+	vector<int> levels(count);
+	vector<char> grades(count);
+	for (int i = 0; i < count; ++i)
+	{
+		levels[i] = (i * 7919) % 100;
+		grades[i] = static_cast<char>('A' + (i * 31) % 4);
+	}
+	vector<uint64_t> bitmap((count + 63) / 64);
+	vector<LevelGradeKernel> kernels = { SelectLevelGradeScalar };
+#ifdef ITEM_SIMD_X86
+	kernels.push_back(SelectLevelGradeSse2);
+	if (CpuHasAvx2()) kernels.push_back(SelectLevelGradeAvx2);
+#endif
+	cout << "rows: " << count << ", selected by " << LevelGradeKernelName(BestLevelGradeKernel()) << endl;
+	for (LevelGradeKernel kernel : kernels)
+	{
+		double ms = MeasureMs([&] { for (int r = 0; r < 10; ++r) kernel(levels.data(), grades.data(), count, 50, 'A', bitmap.data()); }) / 10;
+		size_t selected = 0;
+		for (uint64_t bits : bitmap) selected += bitset<64>(bits).count();
+		double gbPerSecond = count * (sizeof(int) + sizeof(char)) / (ms * 1e6);
+		cout << LevelGradeKernelName(kernel) << " " << ms << " ms, " << gbPerSecond << " GB/s, " << selected << " rows" << endl;
+	}
+	cout << endl;
+}
+
+// 큰 목록에서 임의의 아이템을 하나씩 지우는 시간을 바로 압축(0)과 묘비 비율별 지연 압축으로 비교합니다.
+void BenchmarkTombstones(int count, int removals)
+{
+	cout << "items: " << count << ", single removals: " << removals << endl;
+	for (double ratio : { 0.0, 0.1, 0.25, 0.5 })
+	{
+		ItemManager manager;
+		manager.Reserve(count);
+		for (int i = 0; i < count; ++i) manager.AddItem(manager.MakeItem<Weapon>(i, "단검", i % 100, 'B'));
+		manager.SetMaxDeadRatio(ratio);
+		double ms = MeasureMs([&] { for (int i = 0; i < removals; ++i) manager.RemoveItemById(static_cast<int>((i * 7919ll) % count)); });
+		const ItemManager::CompactionStats& stats = manager.GetCompactionStats();
+		cout << "max dead " << ratio << ": " << ms << " ms, compactions " << stats.compactions << ", moved " << stats.moved
+			<< ", compaction " << stats.totalMs << " ms, tombstones left " << stats.tombstones << endl;
+	}
+	cout << endl;
+}
+
+// 무기만 골라 공격력 합을 구하는 시간을 copy_if + dynamic_pointer_cast, 종류 태그 검사, 종류별 뷰(ForEachOf)로 비교합니다.
+void BenchmarkCategoryFilter(int count)
+{
+	ItemManager manager;
+	vector<shared_ptr<Item>> items;
+	items.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		shared_ptr<Item> item;
+		switch (i % 3)
+		{
+		case 0: { auto weapon = manager.MakeItem<Weapon>(i, "단검", i % 100, 'B'); weapon->attack = i % 10; item = weapon; break; }
+		case 1: item = manager.MakeItem<Armor>(i, "갑옷", i % 100, 'B'); break;
+		default: item = manager.MakeItem<Ring>(i, "반지", i % 100, 'B'); break;
+		}
+		manager.AddItem(item);
+		items.push_back(item);
+	}
+
+	long long castSum = 0, tagSum = 0, viewSum = 0;
+	double castMs = MeasureMs([&] {
+		vector<shared_ptr<Item>> weapons;
+		copy_if(begin(items), end(items), back_inserter(weapons), [](const shared_ptr<Item>& item) { return dynamic_pointer_cast<Weapon>(item) != nullptr; });
+		for (auto& item : weapons) castSum += dynamic_pointer_cast<Weapon>(item)->attack;
+	});
+	double tagMs = MeasureMs([&] {
+		for (auto& item : items) if (item->category == ItemCategory::Weapon) tagSum += static_cast<const Weapon&>(*item).attack;
+	});
+	double viewMs = MeasureMs([&] { manager.ForEachOf<Weapon>([&](const Weapon& weapon) { viewSum += weapon.attack; }); });
+
+	cout << "items: " << count << " weapons (ms, dynamic_pointer_cast / tag / ForEachOf) "
+		<< castMs << " / " << tagMs << " / " << viewMs << ", sum " << castSum << " / " << tagSum << " / " << viewSum << endl;
+	cout << endl;
+}
+
+// 무기 공격력 합, 전체 id 순 레벨 합을 ItemManager(shared_ptr, 종류 태그)와 TypedInventory(종류별 값 벡터)로 비교합니다.
+void BenchmarkTypedInventory(int count)
+{
+	ItemManager manager;
+	TypedInventory<Item, Weapon, Armor, Ring> inventory;
+	for (int i = 0; i < count; ++i)
+	{
+		switch (i % 3)
+		{
+		case 0: { Weapon weapon(i, "단검", i % 100, 'B'); weapon.attack = i % 10; inventory.AddItem(weapon); manager.AddItem(manager.MakeItem<Weapon>(weapon)); break; }
+		case 1: { Armor armor(i, "갑옷", i % 100, 'B'); inventory.AddItem(armor); manager.AddItem(manager.MakeItem<Armor>(armor)); break; }
+		default: { Ring ring(i, "반지", i % 100, 'B'); inventory.AddItem(ring); manager.AddItem(manager.MakeItem<Ring>(ring)); break; }
+		}
+	}
+
+	long long managerAttack = 0, typedAttack = 0, managerLevel = 0, typedLevel = 0;
+	double managerWeaponMs = MeasureMs([&] { manager.ForEachOf<Weapon>([&](const Weapon& weapon) { managerAttack += weapon.attack; }); });
+	double typedWeaponMs = MeasureMs([&] { inventory.ForEach<Weapon>([&](const Weapon& weapon) { typedAttack += weapon.attack; }); });
+	double managerAllMs = MeasureMs([&] { manager.Query(ItemQuery(), [&](const Item& item) { managerLevel += item.level; }); });
+	double typedAllMs = MeasureMs([&] { inventory.VisitInIdOrder([&](const Item& item) { typedLevel += item.level; }); });
+
+	cout << "items: " << count << " (ms, ItemManager / TypedInventory)" << endl;
+	cout << "weapons     " << managerWeaponMs << " / " << typedWeaponMs << ", sum " << managerAttack << " / " << typedAttack << endl;
+	cout << "all by id   " << managerAllMs << " / " << typedAllMs << ", sum " << managerLevel << " / " << typedLevel << endl;
+	cout << endl;
+}
+
+// 아이템을 채우고 지운 뒤 메모리 사용량과 작업별 할당 횟수를 출력합니다. 내보내기 고리는 100ms 마다 불립니다.
+//	작업별 할당 횟수는 ITEM_COUNT_ALLOCATIONS 를 정의하고 빌드해야 나옵니다.
+void BenchmarkMemoryUsage(int count)
+{
+	ItemManager manager;
+	size_t exports = 0;
+	manager.SetStatsExporter([&](const ItemManager&) { ++exports; }, chrono::milliseconds(100));
+	double ms = MeasureMs([&] {
+		FillBenchmarkItems<Weapon, Armor, Ring>(manager, count, [](int i) { return i % 100; }, [](int) { return 'B'; });
+		manager.SetMaxDeadRatio(0.25);
+		for (int i = 0; i < count / 10; ++i) manager.RemoveItemById(i * 10);
+		manager.AutoMerge(count);
+		manager.SortByLevel();
+	});
+
+	ItemManager::MemoryUsage usage = manager.GetMemoryUsage();
+	const char* categoryNames[kItemCategoryCount] = { "item", "weapon", "armor", "ring" };
+	cout << "items: " << usage.liveItems << " (" << ms << " ms, exports " << exports << "), total " << usage.TotalBytes() << " bytes" << endl;
+	for (size_t c = 0; c < kItemCategoryCount; ++c) cout << "  " << categoryNames[c] << " " << usage.itemsByCategory[c] << " items, " << usage.bytesByCategory[c] << " bytes" << endl;
+	cout << "  list " << usage.listBytes << " (slack " << usage.listSlackBytes << "), index " << usage.indexBytes
+		<< ", arena " << usage.arenaLiveBytes << " / " << usage.arenaReservedBytes << ", names " << usage.nameTableBytes << endl;
+	for (size_t op = 0; op < ItemManager::kItemOpCount; ++op)
+	{
+		const ItemManager::OpCounters& counters = manager.GetOpCounters()[op];
+		if (counters.calls == 0) continue;
+		cout << "  " << ItemManager::OpName(static_cast<ItemManager::ItemOp>(op)) << " calls " << counters.calls << ", allocations " << counters.allocations
+			<< ", frees " << counters.frees << ", bytes " << counters.allocatedBytes << endl;
+	}
+	cout << endl;
+}
+
+// 삭제 + 추가 batch 쌍을 공개 함수로 하나씩 부를 때와 트랜잭션 하나로 모아 적용할 때를 비교합니다.
+void BenchmarkTransactions(int count, int batch)
+{
+	auto fill = [&](ItemManager& manager) {
+		manager.Reserve(count + batch);
+		for (int i = 0; i < count; ++i) manager.AddItem(manager.MakeItem<Weapon>(i, "단검", i % 100, 'B'));
+	};
+	auto removedId = [&](int i) { return static_cast<int>((i * 7919ll) % count); };
+
+	ItemManager single;
+	fill(single);
+	double singleMs = MeasureMs([&] {
+		for (int i = 0; i < batch; ++i)
+		{
+			single.RemoveItemById(removedId(i));
+			single.AddItem(single.MakeItem<Weapon>(count + i, "장검", i % 100, 'A'));
+		}
+	});
+
+	ItemManager batched;
+	fill(batched);
+	bool committed = false;
+	double batchMs = MeasureMs([&] {
+		ItemTransaction transaction;
+		for (int i = 0; i < batch; ++i)
+		{
+			transaction.RemoveItemById(removedId(i));
+			transaction.AddItem(batched.MakeItem<Weapon>(count + i, "장검", i % 100, 'A'));
+		}
+		committed = batched.Commit(transaction);
+	});
+
+	cout << "items: " << count << ", batch: " << batch << " remove + add (ms, one by one / transaction) "
+		<< singleMs << " / " << batchMs << (committed ? "" : " (commit failed)") << endl;
+	cout << endl;
+}
+
+// Commit 과 Recover 를 스스로 확인합니다.
+//	같은 목록에 같은 변경을 트랜잭션 하나로 Commit 한 결과와 공개 함수로 하나씩 부른 결과가 같은지,
+//	스냅샷을 저장하고 저널을 비우기 전에 멈췄을 때 Recover 한 결과가 멈추기 전 목록과 같은지 비교합니다.
+void CheckCommitAndRecover(int count, int batch, const string& snapshotPath, const string& journalPath)
+{
+	auto sameItems = [](const ItemManager& a, const ItemManager& b) {
+		return equal(begin(a.ItemsByName()), end(a.ItemsByName()), begin(b.ItemsByName()), end(b.ItemsByName()), [](const Item* x, const Item* y) {
+			return x->id == y->id && x->name == y->name && x->level == y->level && x->grade == y->grade && x->category == y->category && StatOf(*x) == StatOf(*y);
+		});
+	};
+	filesystem::remove(snapshotPath);
+	filesystem::remove(journalPath);
+	ItemJournal journal(journalPath);
+	ItemManager single, committed;
+	committed.AttachJournal(&journal);
+	for (ItemManager* manager : { &single, &committed })
+	{
+		FillBenchmarkItems<Weapon, Armor, Ring>(*manager, count, BenchmarkItemLevel, BenchmarkItemGrade);
+		for (int i = 0; i < count; i += 10) manager->RemoveItemById(i);
+		// 스냅샷 앞의 기록을 다시 적용하면 결과가 달라지도록, 합성 결과와 같은 등급의 재료를 다시 넣어 둡니다.
+		manager->AddItem(manager->MakeItem<Weapon>(-1, "표식", 5, 'C'));
+		manager->AddItem(manager->MakeItem<Weapon>(-2, "표식", 5, 'C'));
+		manager->MergeItems({ { -1, -2, -1 } });
+		manager->AddItem(manager->MakeItem<Weapon>(-2, "표식", 5, UpgradeGrade('C')));
+	}
+	bool saved = committed.SaveSnapshot(snapshotPath);		// 저널은 비우지 않습니다. (Checkpoint 가 Truncate 전에 멈춘 것과 같음)
+
+	// 삭제(1000 단계마다 이름으로), 추가 둘, 그 둘의 합성을 차례로 섞습니다. 트랜잭션은 하나라도 실패하면 통째로 거절되므로 모두 성공하는 단계만 씁니다.
+	ItemTransaction transaction;
+	for (int i = 0; i < batch; ++i)
+	{
+		int id = count + i;
+		switch (i % 4)
+		{
+		case 0:
+			if (i % 1000 == 0)
+			{
+				transaction.RemoveItemByName("투구");
+				single.RemoveItemByName("투구");
+			}
+			else
+			{
+				int removedId = static_cast<int>((i * 7919ll) % count);
+				transaction.RemoveItemById(removedId);
+				single.RemoveItemById(removedId);
+			}
+			break;
+		case 1:
+		case 2:
+			transaction.AddItem(committed.MakeItem<Ring>(id, BenchmarkItemName(i), BenchmarkItemLevel(i), 'A'));
+			single.AddItem(single.MakeItem<Ring>(id, BenchmarkItemName(i), BenchmarkItemLevel(i), 'A'));
+			break;
+		default:
+			transaction.MergeItems(id - 2, id - 1, id);
+			single.MergeItems({ { id - 2, id - 1, id } });		// 하나짜리 배치는 MergeItems(id1, id2, newId) 와 같고 출력이 없습니다.
+			break;
+		}
+	}
+	bool applied = committed.Commit(transaction);
+	journal.Flush();
+
+	ItemManager recovered;
+	bool restored = recovered.Recover(snapshotPath, journalPath);
+	bool sameCommit = applied && sameItems(single, committed);
+	bool sameRecover = saved && restored && !committed.HasJournalError() && sameItems(committed, recovered);
+	filesystem::remove(snapshotPath);
+	filesystem::remove(journalPath);
+
+	cout << "items: " << committed.ItemsByName().size() << ", batch: " << batch << " commit == one by one " << (sameCommit ? "ok" : "mismatch")
+		<< ", recover after snapshot without truncate == live " << (sameRecover ? "ok" : "mismatch") << endl;
+	cout << endl;
+}
+
+// 저장하는 동안 멈추는 시간 : 목록 전체 복사(PublishVersion)와 스냅샷을 비교하고,
+//	스냅샷이 없을 때와 백그라운드 저장 중일 때 같은 변경 batch 쌍(삭제 + 추가)의 시간을 비교합니다.
+void BenchmarkBackgroundSave(int count, int batch, const string& path)
+{
+	for (int items : { count / 10, count })
+	{
+		ItemManager manager;
+		manager.SetMaxDeadRatio(0.25);		// 지울 때마다 압축하는 비용이 섞이지 않도록
+		manager.Reserve(items + 2 * batch);
+		FillBenchmarkItems<Weapon>(manager, items, BenchmarkItemLevel, [](int) { return 'B'; });
+		int nextId = items;
+		auto write = [&] {
+			return MeasureMs([&] {
+				for (int i = 0; i < batch; ++i, ++nextId)
+				{
+					manager.RemoveItemById(static_cast<int>((nextId * 7919ll) % items));
+					manager.AddItem(manager.MakeItem<Weapon>(nextId, "장검", nextId % 100, 'A'));
+				}
+			});
+		};
+
+		double copyMs = MeasureMs([&] { manager.PublishVersion(); });		// 발행은 목록 전체를 복사합니다.
+		double snapshotMs = MeasureMs([&] { manager.TakeSnapshot(); });
+		double plainWriteMs = write();
+		bool started = false, saved = false;
+		double startMs = MeasureMs([&] { started = manager.SaveSnapshotInBackground(path); });
+		double savingWriteMs = write();
+		double waitMs = MeasureMs([&] { saved = manager.WaitBackgroundSave(); });
+		cout << "items: " << items << " pause (ms, full copy / snapshot / background start) " << copyMs << " / " << snapshotMs << " / " << startMs
+			<< ", " << batch << " writes (ms, no snapshot / while saving) " << plainWriteMs << " / " << savingWriteMs
+			<< ", save finished " << waitMs << " ms later" << (started && saved ? "" : " (failed)") << endl;
+	}
+	cout << endl;
+}
+
+// 아이템 수를 늘려가며 직렬, 병렬 경로의 시간을 비교해 병렬이 유리해지는 지점을 찾습니다.
+void BenchmarkParallelCrossover()
+{
+	cout << "items / SortByName / SortByLevel / RemoveItemByName (ms, serial | parallel)" << endl;
+	for (int count : { 1'000, 10'000, 100'000, 1'000'000 })
+	{
+		FlatItemManager serial, parallel;
+		serial.Reserve(count);
+		parallel.Reserve(count);
+		parallel.SetParallelThreshold(0);
+		for (int i = 0; i < count; ++i)
+		{
+			Weapon weapon(i, BenchmarkItemName(i * 31), BenchmarkItemLevel(i), BenchmarkItemGrade(i));
+			serial.AddItem(weapon);
+			parallel.AddItem(weapon);
+		}
+		double serialName = MeasureMs([&] { serial.SortByName(); });
+		double parallelName = MeasureMs([&] { parallel.SortByName(); });
+		double serialLevel = MeasureMs([&] { serial.SortByLevel(); });
+		double parallelLevel = MeasureMs([&] { parallel.SortByLevel(); });
+		double serialRemove = MeasureMs([&] { serial.RemoveItemByName("반지"); });
+		double parallelRemove = MeasureMs([&] { parallel.RemoveItemByName("반지"); });
+
+		bool sameOrder = equal(begin(serial.Items()), end(serial.Items()), begin(parallel.Items()), end(parallel.Items()),
+			[](auto& a, auto& b) { return AsItem(a).id == AsItem(b).id; });
+		cout << count << " / " << serialName << " | " << parallelName << " / " << serialLevel << " | " << parallelLevel
+			<< " / " << serialRemove << " | " << parallelRemove << (sameOrder ? "" : "  (order mismatch)") << endl;
+	}
+	cout << endl;
+}
+
 int main() {
 
 	//Item 목록을 만들고, 동적할당 하세요.	
@@ -126,6 +3911,26 @@ int main() {
 	//합성 후 아이템 목록 출력
 	itemManager.MergeItems(7, 8, 9);
 	itemManager.PrintItems();
+
+	// 저장 방식별 성능 비교 (100만 개)
+	//BenchmarkItemStorage(1'000'000);
+	//BenchmarkParallelCrossover();
+	//BenchmarkItemAllocation(1'000'000);
+	//BenchmarkSnapshot(1'000'000, "items.snapshot");
+	//BenchmarkJournal(100'000, "items.journal");
+	//BenchmarkItemOutput(1'000'000, "items.txt");
+	//BenchmarkConcurrentItems(100'000);
+	//BenchmarkReadVersions(100'000, 4);
+	//BenchmarkLevelQueries(1'000'000);
+	//BenchmarkItemQuery(1'000'000);
+	//BenchmarkLevelGradeFilter(10'000'000);
+	//BenchmarkTombstones(50'000, 15'000);
+	//BenchmarkCategoryFilter(1'000'000);
+	//BenchmarkTypedInventory(1'000'000);
+	//BenchmarkMemoryUsage(1'000'000);
+	//BenchmarkTransactions(30'000, 3'000);
+	//BenchmarkBackgroundSave(1'000'000, 1'000, "items_background.snap");
+	//CheckCommitAndRecover(30'000, 3'000, "items_check.snap", "items_check.journal");
 }
 
 //ItemManager class 를 만들어 코드를 정리하세요.